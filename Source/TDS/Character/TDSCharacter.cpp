@@ -14,7 +14,10 @@
 #include "TDSPlayerState.h"
 #include "Kismet/KismetMathLibrary.h"
 #include "../Core/TDS.h"
+#include "../Core/TDSInputCaptureSubsystem.h"
+#include "../Core/TDSSimulationScheduler.h"
 #include "../Weapon/TDSWeapon.h"
+#include "Net/UnrealNetwork.h"
 
 DEFINE_LOG_CATEGORY(LogTemplateCharacter);
 
@@ -57,32 +60,32 @@ ATDSCharacter::ATDSCharacter()
 	// are set in the derived blueprint asset named ThirdPersonCharacter (to avoid direct content references in C++)
 }
 
+void ATDSCharacter::PostInitializeComponents()
+{
+	Super::PostInitializeComponents();
+
+	VitalsViewModel = NewObject<UTDSVitalsViewModel>(this, TEXT("VitalsViewModel"));
+	VitalsViewModel->OnVitalsChangedNative.AddUObject(this, &ATDSCharacter::HandleVitalsChanged);
+}
+
 void ATDSCharacter::BeginPlay()
 {
 	// Call the base class  
 	Super::BeginPlay();
 
-	//Add Input Mapping Context
-	if (APlayerController* PlayerController = Cast<APlayerController>(Controller))
-	{
-		if (UEnhancedInputLocalPlayerSubsystem* Subsystem = ULocalPlayer::GetSubsystem<UEnhancedInputLocalPlayerSubsystem>(PlayerController->GetLocalPlayer()))
-		{
-			Subsystem->AddMappingContext(DefaultMappingContext, 0);
-		}
+	SetupLocalPlayerInput();
+	UpdateInputCapture();
 
-		// Setting up mouse cursor to show during gameplay
-		PlayerController->SetShowMouseCursor(true);
-		FInputModeGameAndUI InputMode;
-		InputMode.SetHideCursorDuringCapture(false);
-		PlayerController->SetInputMode(InputMode);
+	if(UTDSSimulationScheduler* Scheduler = GetWorld() ? GetWorld()->GetSubsystem<UTDSSimulationScheduler>() : nullptr)
+	{
+		Scheduler->RegisterNetActor(this, ETDSSchedulePriority::High);
 	}
-	ATDSPlayerState* PS = GetPlayerState<ATDSPlayerState>();
-	if(!PS) return;
 
-	UTDSHealthSet* HealthSet = PS->HealthSet;
+	bHasLegacyHealthEvent = GetClass()->IsFunctionImplementedInScript(GET_FUNCTION_NAME_CHECKED(ATDSCharacter, OnHealthChanged));
+	bHasLegacyShieldEvent = GetClass()->IsFunctionImplementedInScript(GET_FUNCTION_NAME_CHECKED(ATDSCharacter, OnShieldChanged));
 
-	AbilitySystemComponent->GetGameplayAttributeValueChangeDelegate(HealthSet->GetHealthAttribute()).AddUObject(this, &ATDSCharacter::OnHealthAttributeChanged);
-	AbilitySystemComponent->GetGameplayAttributeValueChangeDelegate(HealthSet->GetShieldAttribute()).AddUObject(this, &ATDSCharacter::OnShieldAttributeChanged);
+	ATDSPlayerState* PS = GetPlayerState<ATDSPlayerState>();
+	if(!PS) return;
 
 	UWorld* const World = GetWorld();
 	if(World && DefaultWeaponClass)
@@ -94,6 +97,8 @@ void ATDSCharacter::BeginPlay()
 		Weapon = World->SpawnActor<ATDSWeapon>(DefaultWeaponClass, GetActorLocation(), GetActorRotation(), SpawnParameters);
 		if (Weapon)
 		{
+			Weapon->OnShotBatch.AddUObject(this, &ATDSCharacter::OnWeaponShotBatch);
+			Weapon->OnReload.AddUObject(this, &ATDSCharacter::OnWeaponReload);
 			Weapon->Equip();
 		}
 	}
@@ -102,19 +107,96 @@ void ATDSCharacter::BeginPlay()
 
 void ATDSCharacter::Tick(float DeltaSeconds) 
 {
+	SendUnsentShots();
+
+	// Replayed frames drive the pawn instead of the cursor
+	if(ApplyReplayFrame()) return;
+
 	// Cast to the player controller
 	APlayerController* PlayerController = Cast<APlayerController>(Controller);
+	if(!PlayerController) return;
 
 	FHitResult HitResult;
 	if(PlayerController->GetHitResultUnderCursorByChannel(TraceTypeQuery1, true, HitResult))
 	{
-		FVector ActorLocation = FVector(GetActorLocation().X, GetActorLocation().Y, 0.0f);
-		FVector CursorLocation = FVector(HitResult.Location.X, HitResult.Location.Y, 0.0f);
+		ApplyAim(HitResult.Location);
+
+		if(InputCapture)
+		{
+			InputCapture->RecordAim(HitResult.Location);
+		}
+	}
 
-		this->SetActorRotation(UKismetMathLibrary::FindLookAtRotation(ActorLocation, CursorLocation));
+	if(InputCapture)
+	{
+		InputCapture->CommitFrame();
 	}
 }
 
+void ATDSCharacter::NotifyControllerChanged()
+{
+	Super::NotifyControllerChanged();
+
+	// Pooled pawns are possessed long after BeginPlay, possibly by another player
+	SetupLocalPlayerInput();
+	UpdateInputCapture();
+}
+
+void ATDSCharacter::SetupLocalPlayerInput()
+{
+	//Add Input Mapping Context
+	APlayerController* PlayerController = Cast<APlayerController>(Controller);
+	if(!PlayerController || !PlayerController->IsLocalController()) return;
+
+	if (UEnhancedInputLocalPlayerSubsystem* Subsystem = ULocalPlayer::GetSubsystem<UEnhancedInputLocalPlayerSubsystem>(PlayerController->GetLocalPlayer()))
+	{
+		Subsystem->AddMappingContext(DefaultMappingContext, 0);
+	}
+
+	// Setting up mouse cursor to show during gameplay
+	PlayerController->SetShowMouseCursor(true);
+	FInputModeGameAndUI InputMode;
+	InputMode.SetHideCursorDuringCapture(false);
+	PlayerController->SetInputMode(InputMode);
+}
+
+void ATDSCharacter::UpdateInputCapture()
+{
+	InputCapture = IsLocallyControlled() && GetGameInstance() ? GetGameInstance()->GetSubsystem<UTDSInputCaptureSubsystem>() : nullptr;
+}
+
+void ATDSCharacter::ApplyAim(const FVector& AimLocation)
+{
+	FVector ActorLocation = FVector(GetActorLocation().X, GetActorLocation().Y, 0.0f);
+	FVector CursorLocation = FVector(AimLocation.X, AimLocation.Y, 0.0f);
+
+	this->SetActorRotation(UKismetMathLibrary::FindLookAtRotation(ActorLocation, CursorLocation));
+}
+
+bool ATDSCharacter::ApplyReplayFrame()
+{
+	if(!InputCapture || !InputCapture->IsReplaying()) return false;
+
+	FTDSInputFrame Frame;
+	if(!InputCapture->ConsumeReplayFrame(Frame)) return false;
+
+	// Same order as live input: actions fire before the pawn ticks
+	for(uint8 AbilityInput : Frame.AbilityInputs)
+	{
+		DispatchAbilityInput(AbilityInput >> 1, (AbilityInput & 1) != 0);
+	}
+
+	if(!Frame.Move.IsZero())
+	{
+		ApplyMoveInput(FVector2D(Frame.Move));
+	}
+
+	if(Frame.bHasAim)
+	{
+		ApplyAim(FVector(Frame.Aim));
+	}
+	return true;
+}
 
 //////////////////////////////////////////////////////////////////////////
 // Input
@@ -141,6 +223,10 @@ void ATDSCharacter::SetupPlayerInputComponent(UInputComponent* PlayerInputCompon
 		EnhancedInputComponent->BindAction(UtilityAbilityAction, ETriggerEvent::Triggered, this, &ATDSCharacter::OnUtilityAbility);
 		EnhancedInputComponent->BindAction(WeaponFireAction, ETriggerEvent::Triggered, this, &ATDSCharacter::OnWeaponFire);
 		EnhancedInputComponent->BindAction(WeaponAltAction, ETriggerEvent::Triggered, this, &ATDSCharacter::OnWeaponAlt);
+
+		// Native weapon firing
+		EnhancedInputComponent->BindAction(WeaponFireAction, ETriggerEvent::Started, this, &ATDSCharacter::OnWeaponFireStarted);
+		EnhancedInputComponent->BindAction(WeaponFireAction, ETriggerEvent::Completed, this, &ATDSCharacter::OnWeaponFireCompleted);
 	}
 	else
 	{
@@ -150,9 +236,21 @@ void ATDSCharacter::SetupPlayerInputComponent(UInputComponent* PlayerInputCompon
 
 void ATDSCharacter::Move(const FInputActionValue& Value)
 {
+	if(InputCapture && InputCapture->IsReplaying()) return;
+
 	// input is a Vector2D
 	FVector2D MovementVector = Value.Get<FVector2D>();
 
+	if(InputCapture)
+	{
+		InputCapture->RecordMove(MovementVector);
+	}
+
+	ApplyMoveInput(MovementVector);
+}
+
+void ATDSCharacter::ApplyMoveInput(const FVector2D& MovementVector)
+{
 	if (Controller != nullptr)
 	{
 		// find out which way is forward
@@ -200,12 +298,18 @@ void ATDSCharacter::InitAbilitySystemComponent()
 	if(!AbilitySystemComponent.IsValid()) return;
 
 	AbilitySystemComponent->InitAbilityActorInfo(PS, this);
+
+	VitalsViewModel->Bind(AbilitySystemComponent.Get());
 }
 
 void ATDSCharacter::OnRep_PlayerState()
 {
 	Super::OnRep_PlayerState();
 
+	// Unpossessed, or back from the respawn pool with the same player and nothing to set up again
+	ATDSPlayerState* PS = GetPlayerState<ATDSPlayerState>();
+	if(!PS || AbilitySystemComponent.Get() == PS->GetAbilitySystemComponent()) return;
+
 	InitAbilitySystemComponent();
 
 	InitEffects();
@@ -215,8 +319,39 @@ void ATDSCharacter::PossessedBy(AController* NewController)
 {
 	Super::PossessedBy(NewController);
 
+	ATDSPlayerState* PS = GetPlayerState<ATDSPlayerState>();
+	UAbilitySystemComponent* PreviousASC = AbilitySystemComponent.Get();
+	if(PreviousASC && PS && PreviousASC == PS->GetAbilitySystemComponent())
+	{
+		// Pooled pawn back with its own player, abilities, effects and attribute bindings are still in place
+		if(PreviousASC->GetAvatarActor() != this)
+		{
+			InitAbilitySystemComponent();
+		}
+		ResetVitals();
+		return;
+	}
+
+	// Pooled pawn taken over from another player. The abilities it granted there belong to that player's
+	// state and stay with it for their next pawn, only the handles are forgotten
+	GivenAbilities.Reset();
+
 	InitAbilitySystemComponent();
 
+	// State carried over from the previous map or connection replaces the defaults
+	if(PS && PS->RestorePendingGASSnapshot(GivenAbilities)) return;
+
+	// A player state kept by seamless travel, or whose previous pawn is gone, already has everything granted
+	if(HasCarriedGASState())
+	{
+		AdoptGivenAbilities();
+		if(AbilitySystemComponent->GetNumericAttribute(UTDSHealthSet::GetHealthAttribute()) <= 0.0f)
+		{
+			ResetVitals();
+		}
+		return;
+	}
+
 	InitAbilities();
 	InitEffects();
 }
@@ -244,6 +379,9 @@ void ATDSCharacter::OnUtilityAbility(const FInputActionValue& Value)
 
 void ATDSCharacter::OnWeaponFire(const FInputActionValue& Value)
 {
+	// Weapons with native firing don't go through the fire ability
+	if(Weapon && Weapon->HasNativeFiring()) return;
+
 	SendAbilityLocalInput(Value, static_cast<int32>(EAbilityInputID::WeaponFire));
 }
 void ATDSCharacter::OnWeaponAlt(const FInputActionValue& Value)
@@ -251,11 +389,53 @@ void ATDSCharacter::OnWeaponAlt(const FInputActionValue& Value)
 	SendAbilityLocalInput(Value, static_cast<int32>(EAbilityInputID::WeaponAlt));
 }
 
+void ATDSCharacter::OnWeaponFireStarted(const FInputActionValue& Value)
+{
+	if(Weapon && Weapon->HasNativeFiring())
+	{
+		SendAbilityLocalInput(Value, static_cast<int32>(EAbilityInputID::WeaponFire));
+	}
+}
+
+void ATDSCharacter::OnWeaponFireCompleted(const FInputActionValue& Value)
+{
+	if(Weapon && Weapon->HasNativeFiring())
+	{
+		SendAbilityLocalInput(Value, static_cast<int32>(EAbilityInputID::WeaponFire));
+	}
+}
+
 void ATDSCharacter::SendAbilityLocalInput(const FInputActionValue& Value, int32 InputID)
 {
+	if(InputCapture && InputCapture->IsReplaying()) return;
+
+	const bool bPressed = Value.Get<bool>();
+	if(InputCapture)
+	{
+		InputCapture->RecordAbilityInput(InputID, bPressed);
+	}
+
+	DispatchAbilityInput(InputID, bPressed);
+}
+
+void ATDSCharacter::DispatchAbilityInput(int32 InputID, bool bPressed)
+{
+	if(InputID == static_cast<int32>(EAbilityInputID::WeaponFire) && Weapon && Weapon->HasNativeFiring())
+	{
+		if(bPressed)
+		{
+			Weapon->StartFire();
+		}
+		else
+		{
+			Weapon->StopFire();
+		}
+		return;
+	}
+
 	if(!AbilitySystemComponent.IsValid()) return;
 
-	if(Value.Get<bool>())
+	if(bPressed)
 	{
 		AbilitySystemComponent->AbilityLocalInputPressed(InputID);
 	}
@@ -296,6 +476,29 @@ void ATDSCharacter::InitEffects()
 	}
 }
 
+bool ATDSCharacter::HasCarriedGASState() const
+{
+	const UAbilitySystemComponent* ASC = AbilitySystemComponent.Get();
+	return ASC && (ASC->GetActivatableAbilities().Num() > 0 || ASC->GetActiveEffects(FGameplayEffectQuery()).Num() > 0);
+}
+
+void ATDSCharacter::AdoptGivenAbilities()
+{
+	GivenAbilities.Reset();
+	for(TSubclassOf<UTDSGameplayAbility>& Ability : DefaultAbilities)
+	{
+		if(const FGameplayAbilitySpec* Spec = AbilitySystemComponent->FindAbilitySpecFromClass(Ability))
+		{
+			GivenAbilities.Add(Spec->Handle);
+		}
+		else if(HasAuthority())
+		{
+			// Effects alone were carried over, or the abilities were cleared since
+			GivenAbilities.Add(AbilitySystemComponent->GiveAbility(FGameplayAbilitySpec(Ability, 1, static_cast<int32>(Ability.GetDefaultObject()->AbilityInputID), this)));
+		}
+	}
+}
+
 void ATDSCharacter::ClearGivenAbilities()
 {
 	// Server only
@@ -307,15 +510,165 @@ void ATDSCharacter::ClearGivenAbilities()
 	}
 }
 
-void ATDSCharacter::OnHealthAttributeChanged(const FOnAttributeChangeData& Data)
+void ATDSCharacter::HandleVitalsChanged(const FTDSVitals& OldVitals, const FTDSVitals& NewVitals)
+{
+	OnVitalsChanged(OldVitals, NewVitals);
+
+	if(bHasLegacyHealthEvent && OldVitals.Health != NewVitals.Health)
+	{
+		OnHealthChanged(OldVitals.Health, NewVitals.Health);
+	}
+	if(bHasLegacyShieldEvent && OldVitals.Shield != NewVitals.Shield)
+	{
+		OnShieldChanged(OldVitals.Shield, NewVitals.Shield);
+	}
+}
+
+void ATDSCharacter::OnWeaponShotBatch(ATDSWeapon* FiringWeapon, const TArray<FTDSShot>& Shots)
+{
+	if(HasAuthority())
+	{
+		FiringWeapon->HandleShotBatch(Shots);
+	}
+	else
+	{
+		UnsentShots.Append(Shots);
+		SendUnsentShots();
+	}
+}
+
+void ATDSCharacter::SendUnsentShots(bool bForce)
+{
+	const float Now = GetWorld()->GetTimeSeconds();
+	if(UnsentShots.Num() == 0 || (!bForce && LastShotSendTime >= 0.0f && Now - LastShotSendTime < MinShotSendInterval)) return;
+
+	LastShotSendTime = Now;
+	for(int32 First = 0; First < UnsentShots.Num(); First += 64)
+	{
+		ServerFireShots(TArray<FTDSShot>(UnsentShots.GetData() + First, FMath::Min(64, UnsentShots.Num() - First)));
+	}
+	UnsentShots.Reset();
+}
+
+void ATDSCharacter::OnWeaponReload(ATDSWeapon* ReloadingWeapon)
+{
+	if(!HasAuthority() && IsLocallyControlled())
+	{
+		// The server must count the last shots of the magazine before it starts the reload
+		SendUnsentShots(true);
+		ServerReloadWeapon();
+	}
+}
+
+bool ATDSCharacter::ServerFireShots_Validate(const TArray<FTDSShot>& Shots)
 {
-	OnHealthChanged(Data.OldValue, Data.NewValue);
+	// One send interval worth of shots, anything larger is not a real weapon
+	return Shots.Num() <= 64;
 }
 
-void ATDSCharacter::OnShieldAttributeChanged(const FOnAttributeChangeData& Data)
+void ATDSCharacter::ServerFireShots_Implementation(const TArray<FTDSShot>& Shots)
 {
-	OnShieldChanged(Data.OldValue, Data.NewValue);	
+	if(!Weapon) return;
+
+	// The client's batch is a claim, the server's copy of the weapon decides how many of those shots happened
+	TArray<FTDSShot> AcceptedShots = Shots;
+	Weapon->AcceptRemoteShots(AcceptedShots);
+	if(AcceptedShots.Num() < Shots.Num())
+	{
+		UE_LOG(LogTemplateCharacter, Verbose, TEXT("%s: dropped %d of %d shots over the fire rate or magazine"), *GetNameSafe(this), Shots.Num() - AcceptedShots.Num(), Shots.Num());
+	}
+	if(AcceptedShots.Num() > 0)
+	{
+		Weapon->HandleShotBatch(AcceptedShots);
+	}
+}
+
+void ATDSCharacter::ServerReloadWeapon_Implementation()
+{
+	if(Weapon)
+	{
+		Weapon->Reload();
+	}
+}
+
+#pragma region Respawn pool
+void ATDSCharacter::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(ATDSCharacter, bInRespawnPool);
+}
+
+void ATDSCharacter::EnterRespawnPool()
+{
+	if(!HasAuthority() || bInRespawnPool) return;
+
+	PooledPlayerState = GetPlayerState();
+	bInRespawnPool = true;
+	ApplyRespawnPoolState();
+
+	// Nothing changes while pooled. The flush sends the hidden state once more before the channel goes dormant
+	SetNetDormancy(DORM_DormantAll);
+	FlushNetDormancy();
 }
 
+void ATDSCharacter::LeaveRespawnPool(const FTransform& SpawnTransform)
+{
+	if(!HasAuthority() || !bInRespawnPool) return;
+
+	SetNetDormancy(DORM_Awake);
 
+	bInRespawnPool = false;
+	SetActorTransform(SpawnTransform, false, nullptr, ETeleportType::ResetPhysics);
+	ApplyRespawnPoolState();
 
+	ForceNetUpdate();
+}
+
+void ATDSCharacter::OnRep_InRespawnPool()
+{
+	ApplyRespawnPoolState();
+}
+
+void ATDSCharacter::ApplyRespawnPoolState()
+{
+	SetActorHiddenInGame(bInRespawnPool);
+	SetActorEnableCollision(!bInRespawnPool);
+	SetActorTickEnabled(!bInRespawnPool);
+	GetMesh()->SetComponentTickEnabled(!bInRespawnPool);
+
+	UCharacterMovementComponent* Movement = GetCharacterMovement();
+	if(bInRespawnPool)
+	{
+		Movement->StopMovementImmediately();
+		Movement->DisableMovement();
+	}
+	else
+	{
+		Movement->SetDefaultMovementMode();
+	}
+	Movement->SetComponentTickEnabled(!bInRespawnPool);
+
+	if(Weapon)
+	{
+		if(bInRespawnPool)
+		{
+			Weapon->UnEquip();
+		}
+		else
+		{
+			Weapon->Equip();
+		}
+		Weapon->SetActorHiddenInGame(bInRespawnPool);
+		Weapon->SetActorTickEnabled(!bInRespawnPool);
+	}
+}
+
+void ATDSCharacter::ResetVitals()
+{
+	if(!HasAuthority() || !AbilitySystemComponent.IsValid()) return;
+
+	AbilitySystemComponent->SetNumericAttributeBase(UTDSHealthSet::GetHealthAttribute(), AbilitySystemComponent->GetNumericAttribute(UTDSHealthSet::GetMaxHealthAttribute()));
+	AbilitySystemComponent->SetNumericAttributeBase(UTDSHealthSet::GetShieldAttribute(), AbilitySystemComponent->GetNumericAttribute(UTDSHealthSet::GetMaxShieldAttribute()));
+}
+#pragma endregion Respawn pool
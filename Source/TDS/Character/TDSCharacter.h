@@ -9,14 +9,16 @@
 #include "GameplayAbilitySpec.h"
 #include "InputActionValue.h"
 #include "../GASCore/TDSGameplayAbility.h"
+#include "../Weapon/TDSWeapon.h"
+#include "../UI/TDSVitalsViewModel.h"
 #include "TDSCharacter.generated.h"
 
 class USpringArmComponent;
 class UCameraComponent;
 class UInputMappingContext;
 class UInputAction;
+class UTDSInputCaptureSubsystem;
 struct FInputActionValue;
-class ATDSWeapon;
 
 DECLARE_LOG_CATEGORY_EXTERN(LogTemplateCharacter, Log, All);
 
@@ -94,8 +96,28 @@ protected:
 	void OnUtilityAbility(const FInputActionValue& Value);
 	void OnWeaponFire(const FInputActionValue& Value);
 	void OnWeaponAlt(const FInputActionValue& Value);
+	void OnWeaponFireStarted(const FInputActionValue& Value);
+	void OnWeaponFireCompleted(const FInputActionValue& Value);
 
 	virtual void SendAbilityLocalInput(const FInputActionValue& Value, int32 InputID);
+
+	/** Input after it was captured or read back from a replay, shared by live and replayed frames. */
+	void ApplyMoveInput(const FVector2D& MovementVector);
+	void ApplyAim(const FVector& AimLocation);
+	virtual void DispatchAbilityInput(int32 InputID, bool bPressed);
+
+	/** Applies the next replayed frame, false when no replay is running. */
+	bool ApplyReplayFrame();
+
+	/** Input is captured for whichever pawn the local player controls, updated on every possession change. */
+	virtual void NotifyControllerChanged() override;
+	void UpdateInputCapture();
+
+	/** Mapping context and cursor for the local player controlling this pawn. */
+	void SetupLocalPlayerInput();
+
+	UPROPERTY(Transient)
+	UTDSInputCaptureSubsystem* InputCapture;
 	
 
 protected:
@@ -105,6 +127,8 @@ protected:
 	// To add mapping context
 	virtual void BeginPlay();
 
+	virtual void PostInitializeComponents() override;
+
 public:
 	/** Returns CameraBoom subobject **/
 	FORCEINLINE class USpringArmComponent* GetCameraBoom() const { return CameraBoom; }
@@ -129,6 +153,12 @@ protected:
 	virtual void InitEffects();
 	virtual void ClearGivenAbilities();
 
+	/** Whether the ASC still holds abilities or effects from an earlier pawn or map. */
+	bool HasCarriedGASState() const;
+
+	/** Takes over the default abilities already on the ASC and grants the missing ones, so ClearGivenAbilities finds them. */
+	void AdoptGivenAbilities();
+
 	UPROPERTY(BlueprintReadOnly, EditDefaultsOnly, Category = "GAS")
 	TArray<TSubclassOf<UTDSGameplayAbility>> DefaultAbilities;
 	TArray<FGameplayAbilitySpecHandle> GivenAbilities;
@@ -136,14 +166,75 @@ protected:
 	UPROPERTY(BlueprintReadOnly, EditDefaultsOnly, Category = "GAS")
 	TArray<TSubclassOf<UGameplayEffect>> DefaultEffects;
 
-	virtual void OnHealthAttributeChanged(const FOnAttributeChangeData& Data);
+	UPROPERTY(Transient)
+	UTDSVitalsViewModel* VitalsViewModel;
+
+	virtual void HandleVitalsChanged(const FTDSVitals& OldVitals, const FTDSVitals& NewVitals);
 
+	/** Every health and shield change of a frame, delivered once. */
+	UFUNCTION(BlueprintImplementableEvent, Category = "GAS")
+	void OnVitalsChanged(const FTDSVitals& OldVitals, const FTDSVitals& NewVitals);
+
+	/** Per-attribute events, only fired for Blueprints that still implement them. Prefer OnVitalsChanged. */
 	UFUNCTION(BlueprintImplementableEvent, Category = "GAS")
 	void OnHealthChanged(float OldValue, float NewValue);
-	
-	virtual void OnShieldAttributeChanged(const FOnAttributeChangeData& Data);
 
 	UFUNCTION(BlueprintImplementableEvent, Category = "GAS")
 	void OnShieldChanged(float OldValue, float NewValue);
+
+	bool bHasLegacyHealthEvent{false};
+	bool bHasLegacyShieldEvent{false};
+
+public:
+	UFUNCTION(BlueprintPure, Category = "GAS")
+	UTDSVitalsViewModel* GetVitalsViewModel() const { return VitalsViewModel; }
+
+protected:
+	/** Forwards the shots a locally fired weapon emitted this frame to the server, batched to at most one RPC per MinShotSendInterval. */
+	virtual void OnWeaponShotBatch(ATDSWeapon* FiringWeapon, const TArray<FTDSShot>& Shots);
+	virtual void OnWeaponReload(ATDSWeapon* ReloadingWeapon);
+
+	/** Sends the shots waiting for the next RPC once MinShotSendInterval has passed, or right away when forced. */
+	void SendUnsentShots(bool bForce = false);
+
+	UFUNCTION(Server, Reliable, WithValidation)
+	void ServerFireShots(const TArray<FTDSShot>& Shots);
+
+	UFUNCTION(Server, Reliable)
+	void ServerReloadWeapon();
+
+	/** Keeps the reliable shot RPCs of a firing client to a bounded rate. */
+	UPROPERTY(EditDefaultsOnly, Category = "Weapons", meta = (ClampMin = 0.0f))
+	float MinShotSendInterval{1.0f / 30.0f};
+
+private:
+	TArray<FTDSShot> UnsentShots;
+	float LastShotSendTime{-1.0f};
+
+public:
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+	/** Hides and freezes the pawn for UTDSRespawnSubsystem, call before unpossessing. Server only. */
+	void EnterRespawnPool();
+
+	/** Brings the pawn back at SpawnTransform, ready to be possessed. Server only. */
+	void LeaveRespawnPool(const FTransform& SpawnTransform);
+
+	bool IsInRespawnPool() const { return bInRespawnPool; }
+	const APlayerState* GetPooledPlayerState() const { return PooledPlayerState.Get(); }
+
+protected:
+	/** Health and shield back to full when a pooled pawn respawns with the same player. */
+	virtual void ResetVitals();
+
+	void ApplyRespawnPoolState();
+
+	UFUNCTION()
+	void OnRep_InRespawnPool();
+
+	UPROPERTY(ReplicatedUsing = OnRep_InRespawnPool)
+	bool bInRespawnPool{false};
+
+	TWeakObjectPtr<APlayerState> PooledPlayerState;
 };
 
@@ -4,13 +4,32 @@
 #include "TDSPlayerState.h"
 #include "AbilitySystemComponent.h"
 #include "../GASCore/TDSHealthSet.h"
+#include "../GASCore/TDSGASSnapshot.h"
+#include "../GASCore/TDSPeriodicEffectSubsystem.h"
+#include "../GASCore/TDSReplicationPolicy.h"
+#include "../Core/TDSSimulationScheduler.h"
 
 ATDSPlayerState::ATDSPlayerState()
 {
 	AbilitySystemComponent = CreateDefaultSubobject<UAbilitySystemComponent>("AbilitySystemComponent");
-	AbilitySystemComponent->SetIsReplicated(true);
+	TDSReplicationPolicy::ConfigurePlayerASC(AbilitySystemComponent);
 
 	HealthSet = CreateDefaultSubobject<UTDSHealthSet>("HealthSet");
+	CombatSet = CreateDefaultSubobject<UTDSCombatSet>("CombatSet");
+}
+
+void ATDSPlayerState::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if(UTDSSimulationScheduler* Scheduler = GetWorld() ? GetWorld()->GetSubsystem<UTDSSimulationScheduler>() : nullptr)
+	{
+		Scheduler->RegisterNetActor(this, ETDSSchedulePriority::Normal);
+	}
+	if(UTDSPeriodicEffectSubsystem* PeriodicEffects = GetWorld() ? GetWorld()->GetSubsystem<UTDSPeriodicEffectSubsystem>() : nullptr)
+	{
+		PeriodicEffects->Register(AbilitySystemComponent);
+	}
 }
 
 UAbilitySystemComponent* ATDSPlayerState::GetAbilitySystemComponent() const
@@ -18,3 +37,40 @@ UAbilitySystemComponent* ATDSPlayerState::GetAbilitySystemComponent() const
 	return AbilitySystemComponent;
 }
 
+bool ATDSPlayerState::SaveGASSnapshot(TArray<uint8>& OutData) const
+{
+	return AbilitySystemComponent && FTDSGASSnapshot::Capture(*AbilitySystemComponent, OutData);
+}
+
+bool ATDSPlayerState::RestoreGASSnapshot(const TArray<uint8>& Data)
+{
+	return AbilitySystemComponent && FTDSGASSnapshot::Restore(*AbilitySystemComponent, Data);
+}
+
+bool ATDSPlayerState::RestorePendingGASSnapshot(TArray<FGameplayAbilitySpecHandle>& OutAbilityHandles)
+{
+	if(PendingGASSnapshot.Num() == 0 || !AbilitySystemComponent) return false;
+
+	const bool bRestored = FTDSGASSnapshot::Restore(*AbilitySystemComponent, PendingGASSnapshot, &OutAbilityHandles);
+	PendingGASSnapshot.Empty();
+	return bRestored;
+}
+
+void ATDSPlayerState::CopyProperties(APlayerState* PlayerState)
+{
+	Super::CopyProperties(PlayerState);
+
+	// Restored when the new pawn is possessed, instead of rebuilding from the default effects
+	if(ATDSPlayerState* TDSPlayerState = Cast<ATDSPlayerState>(PlayerState))
+	{
+		SaveGASSnapshot(TDSPlayerState->PendingGASSnapshot);
+	}
+}
+
+void ATDSPlayerState::ClientReceiveCueBatch_Implementation(const TArray<FTDSCueBatchEntry>& Entries)
+{
+	if(UTDSCueBatchSubsystem* CueBatch = GetWorld() ? GetWorld()->GetSubsystem<UTDSCueBatchSubsystem>() : nullptr)
+	{
+		CueBatch->ExecuteBatch(Entries);
+	}
+}
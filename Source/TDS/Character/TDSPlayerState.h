@@ -6,6 +6,8 @@
 #include "GameFramework/PlayerState.h"
 #include "AbilitySystemInterface.h"
 #include "../GASCore/TDSHealthSet.h"
+#include "../GASCore/TDSCombatSet.h"
+#include "../GASCore/TDSCueBatchSubsystem.h"
 #include "TDSPlayerState.generated.h"
 
 /**
@@ -25,7 +27,32 @@ public:
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "GAS", meta = (AllowPrivateAccess = true))
 	UTDSHealthSet* HealthSet;
 
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "GAS", meta = (AllowPrivateAccess = true))
+	UTDSCombatSet* CombatSet;
+
+	/** Binary snapshot of attributes, abilities and active effects, for checkpoints and moving players between servers. Server only. */
+	UFUNCTION(BlueprintCallable, Category = "GAS")
+	bool SaveGASSnapshot(TArray<uint8>& OutData) const;
+
+	/** Replaces the current GAS state with a snapshot taken by SaveGASSnapshot. Server only. */
+	UFUNCTION(BlueprintCallable, Category = "GAS")
+	bool RestoreGASSnapshot(const TArray<uint8>& Data);
+
+	/** Restores a snapshot carried over by seamless travel, true when there was one. */
+	bool RestorePendingGASSnapshot(TArray<FGameplayAbilitySpecHandle>& OutAbilityHandles);
+
+	// Carries the GAS state to the player state of the next map
+	virtual void CopyProperties(APlayerState* PlayerState) override;
+
+	/** This frame's gameplay cues from UTDSCueBatchSubsystem, in one message. */
+	UFUNCTION(Client, Unreliable)
+	void ClientReceiveCueBatch(const TArray<FTDSCueBatchEntry>& Entries);
+
 protected:
 	UPROPERTY()
 	UAbilitySystemComponent* AbilitySystemComponent;
+
+	TArray<uint8> PendingGASSnapshot;
+
+	virtual void BeginPlay() override;
 };
@@ -0,0 +1,279 @@
+// Copyright, The Lounge
+
+
+#include "TDSBudgetTracker.h"
+#include "AbilitySystemComponent.h"
+#include "AbilitySystemGlobals.h"
+#include "AttributeSet.h"
+#include "EngineUtils.h"
+#include "TimerManager.h"
+#include "Dom/JsonObject.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/ArchiveCountMem.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+#include "UObject/UObjectHash.h"
+
+DEFINE_LOG_CATEGORY(LogTDSBudget);
+
+namespace TDSBudget
+{
+	/** Same measure as obj list: serialized size plus the resources the object owns exclusively. */
+	static int64 GetObjectBytes(UObject* Object)
+	{
+		FArchiveCountMem CountMem(Object);
+		return static_cast<int64>(CountMem.GetMax()) + Object->GetResourceSizeBytes(EResourceSizeMode::Exclusive);
+	}
+
+	/** Actors whose closest native class comes from this module. */
+	static bool IsTDSActor(const AActor* Actor)
+	{
+		for(const UClass* Class = Actor->GetClass(); Class; Class = Class->GetSuperClass())
+		{
+			if(Class->HasAnyClassFlags(CLASS_Native))
+			{
+				return Class->GetOutermost()->GetFName() == TEXT("/Script/TDS");
+			}
+		}
+		return false;
+	}
+
+	/** The avatar a GAS actor's ASC drives, the actor that owns it while it has none. */
+	static const AActor* GetGASAccountingActor(const UAbilitySystemComponent& AbilitySystemComponent)
+	{
+		const AActor* Avatar = AbilitySystemComponent.GetAvatarActor();
+		return IsValid(Avatar) && Avatar != AbilitySystemComponent.GetOwner() && IsTDSActor(Avatar) ? Avatar : AbilitySystemComponent.GetOwner();
+	}
+
+	static FString FormatKilobytes(int64 Bytes)
+	{
+		return FString::Printf(TEXT("%.1f KB"), Bytes / 1024.0);
+	}
+
+	static FAutoConsoleCommandWithWorldAndArgs ReportCommand(
+		TEXT("TDS.Budget.Report"),
+		TEXT("Logs object counts and memory per TDS actor class. Usage: TDS.Budget.Report [json [file]]"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+		{
+			const UTDSBudgetTracker* BudgetTracker = World ? World->GetSubsystem<UTDSBudgetTracker>() : nullptr;
+			if(!BudgetTracker) return;
+
+			FString FilePath;
+			if(Args.Num() > 0 && Args[0] == TEXT("json"))
+			{
+				FilePath = Args.Num() > 1 ? Args[1] : FString::Printf(TEXT("TDSBudget-%s.json"), *FDateTime::Now().ToString());
+				if(FPaths::IsRelative(FilePath))
+				{
+					FilePath = FPaths::Combine(FPaths::ProfilingDir(), FilePath);
+				}
+			}
+			BudgetTracker->Report(FilePath);
+		}));
+}
+
+void UTDSBudgetTracker::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	if(BudgetCheckInterval > 0.0f && !Budgets.IsEmpty())
+	{
+		InWorld.GetTimerManager().SetTimer(BudgetCheckTimer, FTimerDelegate::CreateUObject(this, &UTDSBudgetTracker::CheckBudgetsPeriodically), BudgetCheckInterval, true);
+	}
+}
+
+void UTDSBudgetTracker::CheckBudgetsPeriodically()
+{
+	TArray<FTDSClassUsage> Usage;
+	CollectUsage(Usage);
+	CheckBudgets(Usage);
+}
+
+void UTDSBudgetTracker::CollectUsage(TArray<FTDSClassUsage>& OutUsage) const
+{
+	OutUsage.Reset();
+
+	UWorld* World = GetWorld();
+	if(!World) return;
+
+	TMap<UClass*, int32> UsageIndexByClass;
+	TArray<UObject*, TInlineAllocator<8>> GASObjects;
+	for(TActorIterator<AActor> It(World); It; ++It)
+	{
+		AActor* Actor = *It;
+		if(!IsValid(Actor) || !TDSBudget::IsTDSActor(Actor)) continue;
+
+		const int32* ExistingIndex = UsageIndexByClass.Find(Actor->GetClass());
+		FTDSClassUsage& Usage = ExistingIndex ? OutUsage[*ExistingIndex] : OutUsage[UsageIndexByClass.Add(Actor->GetClass(), OutUsage.AddDefaulted())];
+		Usage.Class = Actor->GetClass();
+		++Usage.Instances;
+
+		const int64 ActorBytes = TDSBudget::GetObjectBytes(Actor);
+		int64 InstanceBytes = ActorBytes;
+		Usage.ActorBytes += ActorBytes;
+		++Usage.Objects;
+
+		// Counted once, for the character using it rather than the player state holding it. The player state
+		// still skips them below, they are its subobjects
+		GASObjects.Reset();
+		UAbilitySystemComponent* AbilitySystemComponent = UAbilitySystemGlobals::GetAbilitySystemComponentFromActor(Actor);
+		if(AbilitySystemComponent)
+		{
+			GASObjects.Add(AbilitySystemComponent);
+			for(UAttributeSet* AttributeSet : AbilitySystemComponent->GetSpawnedAttributes())
+			{
+				if(AttributeSet)
+				{
+					GASObjects.Add(AttributeSet);
+				}
+			}
+		}
+		if(AbilitySystemComponent && TDSBudget::GetGASAccountingActor(*AbilitySystemComponent) == Actor)
+		{
+			for(FActiveGameplayEffectsContainer::ConstIterator EffectIt = AbilitySystemComponent->GetActiveGameplayEffects().CreateConstIterator(); EffectIt; ++EffectIt)
+			{
+				Usage.EffectBytes += sizeof(FActiveGameplayEffect) + EffectIt->Spec.Modifiers.GetAllocatedSize() + EffectIt->Spec.SetByCallerTagMagnitudes.GetAllocatedSize();
+				++Usage.ActiveEffects;
+			}
+
+			for(UObject* GASObject : GASObjects)
+			{
+				const int64 Bytes = TDSBudget::GetObjectBytes(GASObject);
+				Usage.GASBytes += Bytes;
+				InstanceBytes += Bytes;
+				++Usage.Objects;
+			}
+		}
+
+		ForEachObjectWithOuter(Actor, [&Usage, &InstanceBytes, &GASObjects](UObject* Object)
+		{
+			if(GASObjects.Contains(Object)) return;
+
+			const int64 Bytes = TDSBudget::GetObjectBytes(Object);
+			if(Object->IsA<UActorComponent>())
+			{
+				Usage.ComponentBytes += Bytes;
+			}
+			else
+			{
+				Usage.OtherBytes += Bytes;
+			}
+			InstanceBytes += Bytes;
+			++Usage.Objects;
+		}, true);
+
+		Usage.WorstInstances.Emplace(Actor->GetName(), InstanceBytes);
+	}
+
+	for(FTDSClassUsage& Usage : OutUsage)
+	{
+		Usage.WorstInstances.Sort([](const TPair<FString, int64>& A, const TPair<FString, int64>& B) { return A.Value > B.Value; });
+		Usage.WorstInstances.SetNum(FMath::Min(Usage.WorstInstances.Num(), FMath::Max(NumWorstInstances, 1)));
+	}
+	OutUsage.Sort([](const FTDSClassUsage& A, const FTDSClassUsage& B) { return A.GetTotalBytes() > B.GetTotalBytes(); });
+}
+
+void UTDSBudgetTracker::Report(const FString& FilePath) const
+{
+	TArray<FTDSClassUsage> Usage;
+	CollectUsage(Usage);
+
+	int64 TotalBytes = 0;
+	UE_LOG(LogTDSBudget, Display, TEXT("%-40s %9s %8s %12s %12s %12s %12s %12s %12s"), TEXT("Class"), TEXT("Instances"), TEXT("Objects"), TEXT("Total"), TEXT("Actor"), TEXT("Components"), TEXT("GAS"), TEXT("Effects"), TEXT("Other"));
+	for(const FTDSClassUsage& ClassUsage : Usage)
+	{
+		UE_LOG(LogTDSBudget, Display, TEXT("%-40s %9d %8d %12s %12s %12s %12s %12s %12s"),
+			*ClassUsage.Class->GetName(), ClassUsage.Instances, ClassUsage.Objects,
+			*TDSBudget::FormatKilobytes(ClassUsage.GetTotalBytes()), *TDSBudget::FormatKilobytes(ClassUsage.ActorBytes),
+			*TDSBudget::FormatKilobytes(ClassUsage.ComponentBytes), *TDSBudget::FormatKilobytes(ClassUsage.GASBytes),
+			*TDSBudget::FormatKilobytes(ClassUsage.EffectBytes), *TDSBudget::FormatKilobytes(ClassUsage.OtherBytes));
+		TotalBytes += ClassUsage.GetTotalBytes();
+	}
+	UE_LOG(LogTDSBudget, Display, TEXT("Total %s over %d classes"), *TDSBudget::FormatKilobytes(TotalBytes), Usage.Num());
+
+	CheckBudgets(Usage);
+
+	if(!FilePath.IsEmpty() && WriteJson(Usage, FilePath))
+	{
+		UE_LOG(LogTDSBudget, Display, TEXT("Budget report written to %s"), *FilePath);
+	}
+}
+
+void UTDSBudgetTracker::CheckBudgets(const TArray<FTDSClassUsage>& Usage) const
+{
+	for(const FTDSClassBudget& Budget : Budgets)
+	{
+		const UClass* BudgetClass = Budget.ActorClass.Get();
+		if(!BudgetClass) continue;
+
+		int32 Instances = 0;
+		for(const FTDSClassUsage& ClassUsage : Usage)
+		{
+			if(!ClassUsage.Class->IsChildOf(BudgetClass)) continue;
+
+			Instances += ClassUsage.Instances;
+			if(Budget.MaxKilobytesPerInstance <= 0) continue;
+
+			const int64 MaxBytes = static_cast<int64>(Budget.MaxKilobytesPerInstance) * 1024;
+			for(const TPair<FString, int64>& Instance : ClassUsage.WorstInstances)
+			{
+				// Sorted, the rest are within budget
+				if(Instance.Value <= MaxBytes) break;
+
+				UE_LOG(LogTDSBudget, Warning, TEXT("%s is %s, over the %d KB budget of %s"), *Instance.Key, *TDSBudget::FormatKilobytes(Instance.Value), Budget.MaxKilobytesPerInstance, *BudgetClass->GetName());
+			}
+		}
+
+		if(Budget.MaxInstances > 0 && Instances > Budget.MaxInstances)
+		{
+			UE_LOG(LogTDSBudget, Warning, TEXT("%d instances of %s, over the budget of %d"), Instances, *BudgetClass->GetName(), Budget.MaxInstances);
+		}
+	}
+}
+
+bool UTDSBudgetTracker::WriteJson(const TArray<FTDSClassUsage>& Usage, const FString& FilePath) const
+{
+	TArray<TSharedPtr<FJsonValue>> Classes;
+	for(const FTDSClassUsage& ClassUsage : Usage)
+	{
+		TSharedRef<FJsonObject> ClassObject = MakeShared<FJsonObject>();
+		ClassObject->SetStringField(TEXT("class"), ClassUsage.Class->GetPathName());
+		ClassObject->SetNumberField(TEXT("instances"), ClassUsage.Instances);
+		ClassObject->SetNumberField(TEXT("objects"), ClassUsage.Objects);
+		ClassObject->SetNumberField(TEXT("totalBytes"), ClassUsage.GetTotalBytes());
+		ClassObject->SetNumberField(TEXT("actorBytes"), ClassUsage.ActorBytes);
+		ClassObject->SetNumberField(TEXT("componentBytes"), ClassUsage.ComponentBytes);
+		ClassObject->SetNumberField(TEXT("gasBytes"), ClassUsage.GASBytes);
+		ClassObject->SetNumberField(TEXT("effectBytes"), ClassUsage.EffectBytes);
+		ClassObject->SetNumberField(TEXT("activeEffects"), ClassUsage.ActiveEffects);
+		ClassObject->SetNumberField(TEXT("otherBytes"), ClassUsage.OtherBytes);
+
+		TArray<TSharedPtr<FJsonValue>> WorstInstances;
+		for(const TPair<FString, int64>& Instance : ClassUsage.WorstInstances)
+		{
+			TSharedRef<FJsonObject> InstanceObject = MakeShared<FJsonObject>();
+			InstanceObject->SetStringField(TEXT("name"), Instance.Key);
+			InstanceObject->SetNumberField(TEXT("bytes"), Instance.Value);
+			WorstInstances.Add(MakeShared<FJsonValueObject>(InstanceObject));
+		}
+		ClassObject->SetArrayField(TEXT("worstInstances"), WorstInstances);
+
+		Classes.Add(MakeShared<FJsonValueObject>(ClassObject));
+	}
+
+	TSharedRef<FJsonObject> Root = MakeShared<FJsonObject>();
+	Root->SetStringField(TEXT("map"), GetWorld() ? GetWorld()->GetMapName() : FString());
+	Root->SetStringField(TEXT("time"), FDateTime::UtcNow().ToIso8601());
+	Root->SetArrayField(TEXT("classes"), Classes);
+
+	FString Json;
+	const TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Json);
+	if(!FJsonSerializer::Serialize(Root, Writer) || !FFileHelper::SaveStringToFile(Json, *FilePath))
+	{
+		UE_LOG(LogTDSBudget, Error, TEXT("Could not write budget report %s"), *FilePath);
+		return false;
+	}
+	return true;
+}
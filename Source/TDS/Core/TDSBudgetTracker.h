@@ -0,0 +1,94 @@
+// Copyright, The Lounge
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "TDSBudgetTracker.generated.h"
+
+DECLARE_LOG_CATEGORY_EXTERN(LogTDSBudget, Log, All);
+
+/** Memory and count budget of one actor class and its subclasses. */
+USTRUCT()
+struct FTDSClassBudget
+{
+	GENERATED_BODY()
+
+	UPROPERTY(Config)
+	TSoftClassPtr<AActor> ActorClass;
+
+	/** Per instance, everything counted for it. 0 for no limit. */
+	UPROPERTY(Config)
+	int32 MaxKilobytesPerInstance{0};
+
+	/** Live instances in the world. 0 for no limit. */
+	UPROPERTY(Config)
+	int32 MaxInstances{0};
+};
+
+/** What the instances of one class cost, summed. */
+struct FTDSClassUsage
+{
+	UClass* Class{nullptr};
+	int32 Instances{0};
+	int32 Objects{0};
+
+	int64 ActorBytes{0};
+	int64 ComponentBytes{0};
+
+	/** ASC and attribute sets the actor uses. A character's live on its player state and are counted for the character, the player state counts them only while it has no pawn. */
+	int64 GASBytes{0};
+
+	/** Estimate of the active effects, part of GASBytes. */
+	int64 EffectBytes{0};
+	int32 ActiveEffects{0};
+
+	/** Every other object outered to the actors. */
+	int64 OtherBytes{0};
+
+	/** Largest instances first, trimmed to a few. */
+	TArray<TPair<FString, int64>> WorstInstances;
+
+	int64 GetTotalBytes() const { return ActorBytes + ComponentBytes + GASBytes + OtherBytes; }
+};
+
+/**
+ * Walks the TDS actors of a world and reports UObject counts and bytes per class, split into the actor,
+ * its components, GAS state and everything else outered to it. Classes over their configured budget
+ * are logged as warnings with their largest instances, every BudgetCheckInterval seconds and with each report.
+ *
+ * TDS.Budget.Report logs the report, TDS.Budget.Report json [file] also writes it as JSON,
+ * to Saved/Profiling by default.
+ */
+UCLASS(config=Game)
+class TDS_API UTDSBudgetTracker : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+
+	void CollectUsage(TArray<FTDSClassUsage>& OutUsage) const;
+
+	/** Logs the usage and budget warnings, writes JSON when FilePath is set. */
+	void Report(const FString& FilePath) const;
+
+protected:
+	UPROPERTY(Config)
+	TArray<FTDSClassBudget> Budgets;
+
+	/** Largest instances kept per class for warnings. */
+	UPROPERTY(Config)
+	int32 NumWorstInstances{5};
+
+	/** Seconds between two budget checks while playing, 0 to only check with TDS.Budget.Report. */
+	UPROPERTY(Config)
+	float BudgetCheckInterval{30.0f};
+
+private:
+	void CheckBudgets(const TArray<FTDSClassUsage>& Usage) const;
+	void CheckBudgetsPeriodically();
+	bool WriteJson(const TArray<FTDSClassUsage>& Usage, const FString& FilePath) const;
+
+	FTimerHandle BudgetCheckTimer;
+};
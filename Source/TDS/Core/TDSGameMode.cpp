@@ -2,6 +2,8 @@
 
 #include "TDSGameMode.h"
 #include "../Character/TDSCharacter.h"
+#include "TDSGameState.h"
+#include "TDSRespawnSubsystem.h"
 #include "UObject/ConstructorHelpers.h"
 
 ATDSGameMode::ATDSGameMode()
@@ -12,4 +14,19 @@ ATDSGameMode::ATDSGameMode()
 	{
 		DefaultPawnClass = PlayerPawnBPClass.Class;
 	}
+
+	GameStateClass = ATDSGameState::StaticClass();
+}
+
+APawn* ATDSGameMode::SpawnDefaultPawnAtTransform_Implementation(AController* NewPlayer, const FTransform& SpawnTransform)
+{
+	if(UTDSRespawnSubsystem* RespawnSubsystem = GetWorld()->GetSubsystem<UTDSRespawnSubsystem>())
+	{
+		if(ATDSCharacter* PooledPawn = RespawnSubsystem->AcquirePawn(NewPlayer, GetDefaultPawnClassForController(NewPlayer), SpawnTransform))
+		{
+			return PooledPawn;
+		}
+	}
+
+	return Super::SpawnDefaultPawnAtTransform_Implementation(NewPlayer, SpawnTransform);
 }
@@ -13,6 +13,9 @@ class ATDSGameMode : public AGameModeBase
 
 public:
 	ATDSGameMode();
+
+	/** Takes a dormant pawn from UTDSRespawnSubsystem before spawning a new one. */
+	virtual APawn* SpawnDefaultPawnAtTransform_Implementation(AController* NewPlayer, const FTransform& SpawnTransform) override;
 };
 
 
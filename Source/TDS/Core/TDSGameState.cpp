@@ -0,0 +1,28 @@
+// Copyright, The Lounge
+
+
+#include "TDSGameState.h"
+#include "../GASCore/TDSReplicationPolicy.h"
+#include "Net/UnrealNetwork.h"
+
+void ATDSGameState::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME_CONDITION(ATDSGameState, TagManifestHash, COND_InitialOnly);
+}
+
+void ATDSGameState::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if(HasAuthority())
+	{
+		TagManifestHash = TDSReplicationPolicy::GetTagManifestHash();
+	}
+}
+
+void ATDSGameState::OnRep_TagManifestHash()
+{
+	TDSReplicationPolicy::VerifyTagManifest(TagManifestHash);
+}
@@ -0,0 +1,29 @@
+// Copyright, The Lounge
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/GameStateBase.h"
+#include "TDSGameState.generated.h"
+
+/**
+ * Match-wide replicated state, sent once per connection rather than once per player.
+ */
+UCLASS()
+class TDS_API ATDSGameState : public AGameStateBase
+{
+	GENERATED_BODY()
+
+public:
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+protected:
+	virtual void BeginPlay() override;
+
+	/** Server's gameplay tag network index hash, checked once by each client. */
+	UPROPERTY(ReplicatedUsing = OnRep_TagManifestHash)
+	uint32 TagManifestHash{0};
+
+	UFUNCTION()
+	void OnRep_TagManifestHash();
+};
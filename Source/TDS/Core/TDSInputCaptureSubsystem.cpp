@@ -0,0 +1,349 @@
+// Copyright, The Lounge
+
+
+#include "TDSInputCaptureSubsystem.h"
+#include "Engine/Engine.h"
+#include "Engine/GameInstance.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/App.h"
+#include "Misc/CommandLine.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Parse.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+DEFINE_LOG_CATEGORY(LogTDSInputCapture);
+
+namespace TDSInputCapture
+{
+	static constexpr uint32 FileMagic = 0x49534454; // "TDSI"
+	static constexpr uint16 FileVersion = 1;
+	static constexpr int32 DefaultSeed = 12345;
+
+	static constexpr uint8 FlagHasAim = 1 << 0;
+	static constexpr uint8 FlagHasMove = 1 << 1;
+
+	static int16 QuantizeAxis(float Value)
+	{
+		return static_cast<int16>(FMath::RoundToInt(FMath::Clamp(Value, -1.0f, 1.0f) * MAX_int16));
+	}
+
+	static float DequantizeAxis(int16 Value)
+	{
+		return static_cast<float>(Value) / MAX_int16;
+	}
+
+	static UTDSInputCaptureSubsystem* FindSubsystem(UWorld* World)
+	{
+		UGameInstance* GameInstance = World ? World->GetGameInstance() : nullptr;
+		return GameInstance ? GameInstance->GetSubsystem<UTDSInputCaptureSubsystem>() : nullptr;
+	}
+
+	static FAutoConsoleCommandWithWorldAndArgs RecordCommand(
+		TEXT("TDS.Input.Record"),
+		TEXT("Records local player input to a file. Usage: TDS.Input.Record <file>"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+		{
+			if(UTDSInputCaptureSubsystem* Capture = FindSubsystem(World))
+			{
+				Capture->StartRecording(Args.Num() > 0 ? Args[0] : TEXT("Capture.tdsinput"));
+			}
+		}));
+
+	static FAutoConsoleCommandWithWorldAndArgs ReplayCommand(
+		TEXT("TDS.Input.Replay"),
+		TEXT("Replays a recorded input file at a fixed timestep. Usage: TDS.Input.Replay <file>"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+		{
+			if(UTDSInputCaptureSubsystem* Capture = FindSubsystem(World))
+			{
+				Capture->StartReplay(Args.Num() > 0 ? Args[0] : TEXT("Capture.tdsinput"));
+			}
+		}));
+
+	static FAutoConsoleCommandWithWorldAndArgs StopCommand(
+		TEXT("TDS.Input.Stop"),
+		TEXT("Stops input recording or replay, a recording is written to disk."),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+		{
+			if(UTDSInputCaptureSubsystem* Capture = FindSubsystem(World))
+			{
+				Capture->Stop();
+			}
+		}));
+}
+
+void FTDSInputFrame::Reset()
+{
+	Move = FVector2f::ZeroVector;
+	Aim = FVector3f::ZeroVector;
+	bHasAim = false;
+	AbilityInputs.Reset();
+}
+
+void FTDSInputFrame::Serialize(FArchive& Ar)
+{
+	uint8 Flags = (bHasAim ? TDSInputCapture::FlagHasAim : 0) | (!Move.IsZero() ? TDSInputCapture::FlagHasMove : 0);
+	Ar << Flags;
+
+	if(Flags & TDSInputCapture::FlagHasMove)
+	{
+		int16 MoveX = TDSInputCapture::QuantizeAxis(Move.X);
+		int16 MoveY = TDSInputCapture::QuantizeAxis(Move.Y);
+		Ar << MoveX << MoveY;
+		Move = FVector2f(TDSInputCapture::DequantizeAxis(MoveX), TDSInputCapture::DequantizeAxis(MoveY));
+	}
+	else
+	{
+		Move = FVector2f::ZeroVector;
+	}
+
+	bHasAim = (Flags & TDSInputCapture::FlagHasAim) != 0;
+	if(bHasAim)
+	{
+		Ar << Aim.X << Aim.Y << Aim.Z;
+	}
+
+	uint8 NumAbilityInputs = static_cast<uint8>(FMath::Min(AbilityInputs.Num(), static_cast<int32>(MAX_uint8)));
+	Ar << NumAbilityInputs;
+	if(Ar.IsLoading())
+	{
+		AbilityInputs.SetNumUninitialized(NumAbilityInputs);
+	}
+	Ar.Serialize(AbilityInputs.GetData(), NumAbilityInputs);
+}
+
+void UTDSInputCaptureSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	bExitWhenReplayEnds = FParse::Param(FCommandLine::Get(), TEXT("TDSReplayExit"));
+
+	FString FileName;
+	if(FParse::Value(FCommandLine::Get(), TEXT("TDSReplay="), FileName))
+	{
+		StartReplay(FileName);
+	}
+	else if(FParse::Value(FCommandLine::Get(), TEXT("TDSRecord="), FileName))
+	{
+		StartRecording(FileName);
+	}
+}
+
+void UTDSInputCaptureSubsystem::Deinitialize()
+{
+	Stop();
+
+	Super::Deinitialize();
+}
+
+FString UTDSInputCaptureSubsystem::ResolvePath(const FString& FileName)
+{
+	return FPaths::IsRelative(FileName) ? FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("InputCaptures"), FileName) : FileName;
+}
+
+void UTDSInputCaptureSubsystem::ApplyDeterminism()
+{
+	FMath::RandInit(Seed);
+	FMath::SRandInit(Seed);
+}
+
+void UTDSInputCaptureSubsystem::ForceFixedFrameRate()
+{
+	if(!GEngine) return;
+
+	// Unlike the fixed timestep, the engine waits out the rest of each frame, the game runs at normal speed
+	bPreviousUseFixedFrameRate = GEngine->bUseFixedFrameRate;
+	PreviousFixedFrameRate = GEngine->FixedFrameRate;
+	GEngine->bUseFixedFrameRate = true;
+	GEngine->FixedFrameRate = 1.0f / FixedDeltaTime;
+}
+
+void UTDSInputCaptureSubsystem::ForceFixedTimeStep()
+{
+	bPreviousUseFixedTimeStep = FApp::UseFixedTimeStep();
+	PreviousFixedDeltaTime = FApp::GetFixedDeltaTime();
+	FApp::SetUseFixedTimeStep(true);
+	FApp::SetFixedDeltaTime(FixedDeltaTime);
+}
+
+void UTDSInputCaptureSubsystem::RestoreTimeStep()
+{
+	if(Mode == EMode::Recording)
+	{
+		if(GEngine)
+		{
+			GEngine->bUseFixedFrameRate = bPreviousUseFixedFrameRate;
+			GEngine->FixedFrameRate = PreviousFixedFrameRate;
+		}
+		return;
+	}
+
+	FApp::SetUseFixedTimeStep(bPreviousUseFixedTimeStep);
+	FApp::SetFixedDeltaTime(PreviousFixedDeltaTime);
+}
+
+bool UTDSInputCaptureSubsystem::StartRecording(const FString& FileName)
+{
+	Stop();
+
+	Seed = TDSInputCapture::DefaultSeed;
+	FParse::Value(FCommandLine::Get(), TEXT("TDSSeed="), Seed);
+	FixedDeltaTime = GEngine && GEngine->bUseFixedFrameRate && GEngine->FixedFrameRate > 0.0f ? 1.0f / GEngine->FixedFrameRate : 1.0f / 60.0f;
+
+	FilePath = ResolvePath(FileName);
+	FrameData.Reset();
+	NumFrames = 0;
+	CurrentFrame.Reset();
+
+	// A frame of input only replays the same when it covered the same time
+	Mode = EMode::Recording;
+	ForceFixedFrameRate();
+	ApplyDeterminism();
+
+	UE_LOG(LogTDSInputCapture, Log, TEXT("Recording input to %s at %.4fs per frame, seed %d"), *FilePath, FixedDeltaTime, Seed);
+	return true;
+}
+
+bool UTDSInputCaptureSubsystem::StartReplay(const FString& FileName)
+{
+	Stop();
+
+	FilePath = ResolvePath(FileName);
+
+	TArray<uint8> FileData;
+	if(!FFileHelper::LoadFileToArray(FileData, *FilePath))
+	{
+		UE_LOG(LogTDSInputCapture, Error, TEXT("Could not read input capture %s"), *FilePath);
+		return false;
+	}
+
+	FMemoryReader Reader(FileData);
+	uint32 Magic = 0;
+	uint16 Version = 0;
+	Reader << Magic << Version;
+	if(Magic != TDSInputCapture::FileMagic || Version != TDSInputCapture::FileVersion)
+	{
+		UE_LOG(LogTDSInputCapture, Error, TEXT("%s is not a version %d input capture"), *FilePath, TDSInputCapture::FileVersion);
+		return false;
+	}
+	Reader << Seed << FixedDeltaTime << NumFrames;
+	if(Reader.IsError() || FixedDeltaTime <= 0.0f || NumFrames < 0)
+	{
+		UE_LOG(LogTDSInputCapture, Error, TEXT("%s has a corrupt header"), *FilePath);
+		return false;
+	}
+
+	const int64 HeaderSize = Reader.Tell();
+	FrameData = TArray<uint8>(FileData.GetData() + HeaderSize, FileData.Num() - static_cast<int32>(HeaderSize));
+	ReplayFrameIndex = 0;
+	ReplayOffset = 0;
+
+	// Same seed and same step on every build, so only code changes move the numbers
+	Mode = EMode::Replaying;
+	ForceFixedTimeStep();
+	ApplyDeterminism();
+
+	UE_LOG(LogTDSInputCapture, Log, TEXT("Replaying %d frames from %s at %.4fs per frame, seed %d"), NumFrames, *FilePath, FixedDeltaTime, Seed);
+	return true;
+}
+
+void UTDSInputCaptureSubsystem::Stop()
+{
+	if(Mode == EMode::Recording)
+	{
+		RestoreTimeStep();
+
+		TArray<uint8> FileData;
+		FMemoryWriter Writer(FileData);
+
+		uint32 Magic = TDSInputCapture::FileMagic;
+		uint16 Version = TDSInputCapture::FileVersion;
+		Writer << Magic << Version << Seed << FixedDeltaTime << NumFrames;
+		Writer.Serialize(FrameData.GetData(), FrameData.Num());
+
+		if(FFileHelper::SaveArrayToFile(FileData, *FilePath))
+		{
+			UE_LOG(LogTDSInputCapture, Log, TEXT("Wrote %d frames (%d bytes) to %s"), NumFrames, FileData.Num(), *FilePath);
+		}
+		else
+		{
+			UE_LOG(LogTDSInputCapture, Error, TEXT("Could not write input capture %s"), *FilePath);
+		}
+	}
+	else if(Mode == EMode::Replaying)
+	{
+		RestoreTimeStep();
+
+		UE_LOG(LogTDSInputCapture, Log, TEXT("Replay of %s stopped after %d of %d frames"), *FilePath, ReplayFrameIndex, NumFrames);
+
+		if(bExitWhenReplayEnds)
+		{
+			FPlatformMisc::RequestExit(false);
+		}
+	}
+
+	Mode = EMode::Idle;
+	FrameData.Empty();
+}
+
+#pragma region Recording
+void UTDSInputCaptureSubsystem::RecordMove(const FVector2D& Move)
+{
+	if(!IsRecording()) return;
+
+	CurrentFrame.Move = FVector2f(Move);
+}
+
+void UTDSInputCaptureSubsystem::RecordAim(const FVector& Aim)
+{
+	if(!IsRecording()) return;
+
+	CurrentFrame.Aim = FVector3f(Aim);
+	CurrentFrame.bHasAim = true;
+}
+
+void UTDSInputCaptureSubsystem::RecordAbilityInput(int32 InputID, bool bPressed)
+{
+	if(!IsRecording() || CurrentFrame.AbilityInputs.Num() >= MAX_uint8) return;
+
+	CurrentFrame.AbilityInputs.Add(static_cast<uint8>((InputID << 1) | (bPressed ? 1 : 0)));
+}
+
+void UTDSInputCaptureSubsystem::CommitFrame()
+{
+	if(!IsRecording()) return;
+
+	FMemoryWriter Writer(FrameData, false, true);
+	CurrentFrame.Serialize(Writer);
+	CurrentFrame.Reset();
+	++NumFrames;
+}
+#pragma endregion Recording
+
+bool UTDSInputCaptureSubsystem::ConsumeReplayFrame(FTDSInputFrame& OutFrame)
+{
+	if(!IsReplaying()) return false;
+
+	if(ReplayFrameIndex >= NumFrames)
+	{
+		Stop();
+		return false;
+	}
+
+	FMemoryReader Reader(FrameData);
+	Reader.Seek(ReplayOffset);
+	OutFrame.Serialize(Reader);
+	if(Reader.IsError())
+	{
+		UE_LOG(LogTDSInputCapture, Error, TEXT("%s is truncated or corrupt at frame %d"), *FilePath, ReplayFrameIndex);
+		OutFrame.Reset();
+		Stop();
+		return false;
+	}
+	ReplayOffset = Reader.Tell();
+	++ReplayFrameIndex;
+	return true;
+}
@@ -0,0 +1,101 @@
+// Copyright, The Lounge
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/GameInstanceSubsystem.h"
+#include "TDSInputCaptureSubsystem.generated.h"
+
+DECLARE_LOG_CATEGORY_EXTERN(LogTDSInputCapture, Log, All);
+
+/**
+ * Local player input of one frame.
+ */
+struct FTDSInputFrame
+{
+	FVector2f Move{FVector2f::ZeroVector};
+	FVector3f Aim{FVector3f::ZeroVector};
+	bool bHasAim{false};
+
+	/** Ability input events in order, (EAbilityInputID << 1) | bPressed. */
+	TArray<uint8, TInlineAllocator<4>> AbilityInputs;
+
+	void Reset();
+	void Serialize(FArchive& Ar);
+};
+
+/**
+ * Records the local player's per-frame input to a compact binary file and replays it with the same random seed,
+ * so perf captures of the same session can be compared across builds. Recording runs the engine at a fixed frame
+ * rate that still waits for real time, replay at the same fixed timestep as fast as the machine allows, so every
+ * replayed frame advances the game by the time it was recorded with.
+ *
+ * Start from the command line with -TDSRecord=<file> or -TDSReplay=<file> (add -TDSReplayExit to quit
+ * when the replay ends), or with the TDS.Input.Record, TDS.Input.Replay and TDS.Input.Stop console commands.
+ * Relative files go to Saved/InputCaptures.
+ */
+UCLASS()
+class TDS_API UTDSInputCaptureSubsystem : public UGameInstanceSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	bool StartRecording(const FString& FileName);
+	bool StartReplay(const FString& FileName);
+	void Stop();
+
+	bool IsRecording() const { return Mode == EMode::Recording; }
+	bool IsReplaying() const { return Mode == EMode::Replaying; }
+
+#pragma region Recording
+	void RecordMove(const FVector2D& Move);
+	void RecordAim(const FVector& Aim);
+	void RecordAbilityInput(int32 InputID, bool bPressed);
+
+	/** Closes the current frame, called once per frame by the recorded pawn. */
+	void CommitFrame();
+#pragma endregion Recording
+
+	/** Next recorded frame, false when the replay has ended. */
+	bool ConsumeReplayFrame(FTDSInputFrame& OutFrame);
+
+private:
+	enum class EMode : uint8
+	{
+		Idle,
+		Recording,
+		Replaying
+	};
+
+	static FString ResolvePath(const FString& FileName);
+	void ApplyDeterminism();
+
+	/** Runs the engine at FixedDeltaTime in real time until RestoreTimeStep, for a player to record with. */
+	void ForceFixedFrameRate();
+
+	/** Runs the engine at FixedDeltaTime as fast as it can until RestoreTimeStep. */
+	void ForceFixedTimeStep();
+	void RestoreTimeStep();
+
+	EMode Mode{EMode::Idle};
+	FString FilePath;
+
+	int32 Seed{0};
+	float FixedDeltaTime{1.0f / 60.0f};
+	bool bExitWhenReplayEnds{false};
+
+	/** Restored when recording or replay stops. */
+	bool bPreviousUseFixedTimeStep{false};
+	double PreviousFixedDeltaTime{0.0};
+	bool bPreviousUseFixedFrameRate{false};
+	float PreviousFixedFrameRate{0.0f};
+
+	FTDSInputFrame CurrentFrame;
+	TArray<uint8> FrameData;
+	int32 NumFrames{0};
+	int32 ReplayFrameIndex{0};
+	int64 ReplayOffset{0};
+};
@@ -0,0 +1,77 @@
+// Copyright, The Lounge
+
+
+#include "TDSRespawnSubsystem.h"
+#include "Engine/World.h"
+#include "GameFramework/Controller.h"
+#include "GameFramework/GameModeBase.h"
+#include "GameFramework/PlayerState.h"
+#include "../Character/TDSCharacter.h"
+
+void UTDSRespawnSubsystem::Deinitialize()
+{
+	DormantPawns.Reset();
+
+	Super::Deinitialize();
+}
+
+void UTDSRespawnSubsystem::ReleasePawn(ATDSCharacter* Pawn)
+{
+	if(!Pawn || !Pawn->HasAuthority() || Pawn->IsInRespawnPool()) return;
+
+	DormantPawns.RemoveAll([](const ATDSCharacter* DormantPawn) { return !IsValid(DormantPawn); });
+	if(DormantPawns.Num() >= MaxPooledPawns)
+	{
+		Pawn->Destroy();
+		return;
+	}
+
+	// Enter before unpossessing, the pawn remembers whose it was
+	Pawn->EnterRespawnPool();
+	if(AController* Controller = Pawn->GetController())
+	{
+		// The pawn is already dormant, the cleared controller, player state and owner need one more flush
+		Controller->UnPossess();
+		Pawn->FlushNetDormancy();
+	}
+	DormantPawns.Add(Pawn);
+}
+
+void UTDSRespawnSubsystem::RespawnPlayer(AController* Controller)
+{
+	if(!Controller || !Controller->HasAuthority()) return;
+
+	if(ATDSCharacter* Pawn = Cast<ATDSCharacter>(Controller->GetPawn()))
+	{
+		ReleasePawn(Pawn);
+	}
+
+	if(AGameModeBase* GameMode = GetWorld()->GetAuthGameMode())
+	{
+		GameMode->RestartPlayer(Controller);
+	}
+}
+
+ATDSCharacter* UTDSRespawnSubsystem::AcquirePawn(AController* Controller, UClass* PawnClass, const FTransform& SpawnTransform)
+{
+	if(!PawnClass || DormantPawns.Num() == 0) return nullptr;
+
+	// The player's own pawn keeps its ASC bindings and granted abilities, any other one of the class still saves the spawn
+	const APlayerState* PlayerState = Controller ? Controller->PlayerState : nullptr;
+	int32 FoundIndex = INDEX_NONE;
+	for(int32 Index = 0; Index < DormantPawns.Num(); ++Index)
+	{
+		const ATDSCharacter* DormantPawn = DormantPawns[Index];
+		if(!IsValid(DormantPawn) || DormantPawn->GetClass() != PawnClass) continue;
+
+		FoundIndex = Index;
+		if(PlayerState && DormantPawn->GetPooledPlayerState() == PlayerState) break;
+	}
+	if(FoundIndex == INDEX_NONE) return nullptr;
+
+	ATDSCharacter* Pawn = DormantPawns[FoundIndex];
+	DormantPawns.RemoveAtSwap(FoundIndex);
+
+	Pawn->LeaveRespawnPool(SpawnTransform);
+	return Pawn;
+}
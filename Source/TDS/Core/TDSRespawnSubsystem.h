@@ -0,0 +1,44 @@
+// Copyright, The Lounge
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "TDSRespawnSubsystem.generated.h"
+
+class ATDSCharacter;
+
+/**
+ * Keeps dead player pawns dormant instead of destroying them. Respawning takes a pooled pawn,
+ * preferably the player's own, resets it in place and hands it back to the game mode for possession,
+ * so components, the weapon and the attribute bindings made in BeginPlay are all kept.
+ */
+UCLASS(config=Game)
+class TDS_API UTDSRespawnSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Deinitialize() override;
+
+	/** Unpossesses the pawn and parks it in the pool, destroys it when the pool is full. Server only. */
+	UFUNCTION(BlueprintCallable, Category = "Respawn")
+	void ReleasePawn(ATDSCharacter* Pawn);
+
+	/** Releases the controller's pawn and restarts the player through the game mode. Server only. */
+	UFUNCTION(BlueprintCallable, Category = "Respawn")
+	void RespawnPlayer(AController* Controller);
+
+	/** Dormant pawn of PawnClass moved to SpawnTransform, the controller's previous pawn first. Null when none is pooled. */
+	ATDSCharacter* AcquirePawn(AController* Controller, UClass* PawnClass, const FTransform& SpawnTransform);
+
+	int32 GetNumPooledPawns() const { return DormantPawns.Num(); }
+
+protected:
+	UPROPERTY(Config)
+	int32 MaxPooledPawns{32};
+
+private:
+	UPROPERTY()
+	TArray<ATDSCharacter*> DormantPawns;
+};
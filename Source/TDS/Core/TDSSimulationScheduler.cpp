@@ -0,0 +1,279 @@
+// Copyright, The Lounge
+
+
+#include "TDSSimulationScheduler.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+
+DEFINE_LOG_CATEGORY(LogTDSScheduler);
+
+CSV_DEFINE_CATEGORY(TDSScheduler, true);
+
+namespace TDSScheduler
+{
+	/** One level per priority below Critical. */
+	static constexpr int32 MaxThrottleLevel = static_cast<int32>(ETDSSchedulePriority::Low);
+
+	static const TCHAR* GetPriorityName(ETDSSchedulePriority Priority)
+	{
+		switch(Priority)
+		{
+		case ETDSSchedulePriority::Critical: return TEXT("Critical");
+		case ETDSSchedulePriority::High: return TEXT("High");
+		case ETDSSchedulePriority::Normal: return TEXT("Normal");
+		case ETDSSchedulePriority::Low: return TEXT("Low");
+		}
+		return TEXT("Unknown");
+	}
+
+	static FAutoConsoleCommandWithWorldAndArgs StatsCommand(
+		TEXT("TDS.Scheduler.Stats"),
+		TEXT("Logs the simulation scheduler's headroom, throttle level and systems."),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+		{
+			if(const UTDSSimulationScheduler* Scheduler = World ? World->GetSubsystem<UTDSSimulationScheduler>() : nullptr)
+			{
+				Scheduler->LogStats();
+			}
+		}));
+}
+
+void UTDSSimulationScheduler::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	TickStartHandle = FWorldDelegates::OnWorldTickStart.AddUObject(this, &UTDSSimulationScheduler::OnWorldTickStart);
+	PostTickFlushHandle = GetWorldRef().OnPostTickFlush().AddUObject(this, &UTDSSimulationScheduler::OnPostTickFlush);
+}
+
+void UTDSSimulationScheduler::Deinitialize()
+{
+	FWorldDelegates::OnWorldTickStart.Remove(TickStartHandle);
+	if(UWorld* World = GetWorld())
+	{
+		World->OnPostTickFlush().Remove(PostTickFlushHandle);
+	}
+
+	Systems.Reset();
+	PendingSystems.Reset();
+	NetActors.Reset();
+
+	Super::Deinitialize();
+}
+
+void UTDSSimulationScheduler::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	UWorld* World = GetWorld();
+	if(!World) return;
+
+	bFixedStep = IsFixedStep();
+
+	CSV_CUSTOM_STAT(TDSScheduler, Headroom, GetHeadroom(), ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(TDSScheduler, ThrottleLevel, ThrottleLevel, ECsvCustomStatOp::Set);
+
+	if(!bFixedStep)
+	{
+		RunStep(DeltaTime);
+		return;
+	}
+
+	const float FixedStep = GetFixedStep();
+	Accumulator += DeltaTime;
+
+	int32 Steps = 0;
+	while(Accumulator >= FixedStep && Steps < MaxStepsPerFrame)
+	{
+		RunStep(FixedStep);
+		Accumulator -= FixedStep;
+		++Steps;
+	}
+
+	// Catching up on everything would make the next frame longer still. Every stepped system loses the same time,
+	// fire rates, damage and regen slow down together for every player
+	if(Accumulator >= FixedStep)
+	{
+		const float Remainder = FMath::Fmod(Accumulator, FixedStep);
+		DroppedTime += Accumulator - Remainder;
+		UE_LOG(LogTDSScheduler, Verbose, TEXT("Dropped %.1f ms of simulation after %d steps"), (Accumulator - Remainder) * 1000.0f, Steps);
+		Accumulator = Remainder;
+	}
+
+	CSV_CUSTOM_STAT(TDSScheduler, Steps, Steps, ECsvCustomStatOp::Set);
+}
+
+TStatId UTDSSimulationScheduler::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UTDSSimulationScheduler, STATGROUP_Tickables);
+}
+
+void UTDSSimulationScheduler::RegisterSystem(FName Name, ETDSSchedulePriority Priority, FTDSScheduledStep Step)
+{
+	UnregisterSystem(Name);
+
+	FScheduledSystem System;
+	System.Name = Name;
+	System.Priority = Priority;
+	System.Step = MoveTemp(Step);
+
+	// A system registered from a step starts on the next one
+	if(bRunningSystems)
+	{
+		PendingSystems.Add(MoveTemp(System));
+		return;
+	}
+
+	const int32 InsertIndex = Systems.IndexOfByPredicate([Priority](const FScheduledSystem& Other) { return Other.Priority > Priority; });
+	Systems.Insert(MoveTemp(System), InsertIndex == INDEX_NONE ? Systems.Num() : InsertIndex);
+}
+
+void UTDSSimulationScheduler::UnregisterSystem(FName Name)
+{
+	PendingSystems.RemoveAll([Name](const FScheduledSystem& System) { return System.Name == Name; });
+
+	for(FScheduledSystem& System : Systems)
+	{
+		if(System.Name == Name)
+		{
+			// Removed once the step is over, the list may be iterated
+			System.Step.Unbind();
+		}
+	}
+	if(!bRunningSystems)
+	{
+		RemoveUnboundSystems();
+	}
+}
+
+void UTDSSimulationScheduler::RegisterNetActor(AActor* Actor, ETDSSchedulePriority Priority)
+{
+	if(!Actor || !Actor->HasAuthority()) return;
+
+	NetActors.RemoveAll([Actor](const FNetActor& NetActor) { return !NetActor.Actor.IsValid() || NetActor.Actor.Get() == Actor; });
+
+	FNetActor& NetActor = NetActors.AddDefaulted_GetRef();
+	NetActor.Actor = Actor;
+	NetActor.Priority = Priority;
+	// Registering again, after a respawn from the pool, must not compound the reduction
+	NetActor.BaseFrequency = Actor->GetClass()->GetDefaultObject<AActor>()->NetUpdateFrequency;
+
+	Actor->NetUpdateFrequency = NetActor.BaseFrequency / GetStepInterval(Priority);
+}
+
+bool UTDSSimulationScheduler::IsFixedStep() const
+{
+	const UWorld* World = GetWorld();
+	const ENetMode NetMode = World ? World->GetNetMode() : NM_Standalone;
+	return NetMode == NM_DedicatedServer || NetMode == NM_ListenServer;
+}
+
+int32 UTDSSimulationScheduler::GetStepInterval(ETDSSchedulePriority Priority) const
+{
+	if(!bFixedStep || Priority == ETDSSchedulePriority::Critical) return 1;
+
+	// Low is throttled from level 1, Normal from 2 and High from 3, each level halves the rate again
+	const int32 Halvings = ThrottleLevel - (TDSScheduler::MaxThrottleLevel - static_cast<int32>(Priority));
+	return Halvings > 0 ? 1 << Halvings : 1;
+}
+
+void UTDSSimulationScheduler::RunStep(float StepTime)
+{
+	++StepCount;
+
+	bRunningSystems = true;
+	for(FScheduledSystem& System : Systems)
+	{
+		// Throttled systems get the whole time they missed, rates stay correct at any interval
+		System.PendingTime += StepTime;
+		if(StepCount % GetStepInterval(System.Priority) != 0) continue;
+
+		const float SystemTime = System.PendingTime;
+		System.PendingTime = 0.0f;
+		System.Step.ExecuteIfBound(SystemTime);
+	}
+	bRunningSystems = false;
+
+	RemoveUnboundSystems();
+
+	if(PendingSystems.Num() > 0)
+	{
+		TArray<FScheduledSystem> Registered = MoveTemp(PendingSystems);
+		for(FScheduledSystem& System : Registered)
+		{
+			RegisterSystem(System.Name, System.Priority, MoveTemp(System.Step));
+		}
+	}
+}
+
+void UTDSSimulationScheduler::RemoveUnboundSystems()
+{
+	Systems.RemoveAll([](const FScheduledSystem& System) { return !System.Step.IsBound(); });
+}
+
+void UTDSSimulationScheduler::OnWorldTickStart(UWorld* InWorld, ELevelTick TickType, float DeltaTime)
+{
+	if(InWorld != GetWorld()) return;
+
+	WorldTickStartTime = FPlatformTime::Seconds();
+}
+
+void UTDSSimulationScheduler::OnPostTickFlush()
+{
+	if(WorldTickStartTime <= 0.0) return;
+
+	// Replication in the net driver's flush is part of the sample, the idle time the server sleeps away to hold its tick rate is not
+	const double WorkTime = FPlatformTime::Seconds() - WorldTickStartTime;
+	UpdateThrottleLevel(static_cast<float>(WorkTime * FMath::Max(TargetFrameRate, 1.0f)));
+}
+
+void UTDSSimulationScheduler::UpdateThrottleLevel(float LoadSample)
+{
+	SmoothedLoad = FMath::Lerp(SmoothedLoad, LoadSample, FMath::Clamp(LoadSmoothing, 0.0f, 1.0f));
+	if(!bFixedStep) return;
+
+	const double Now = FPlatformTime::Seconds();
+	if(Now - LastThrottleChangeTime < ThrottleHoldTime) return;
+
+	int32 NewLevel = ThrottleLevel;
+	if(SmoothedLoad > ThrottleUpLoad)
+	{
+		NewLevel = FMath::Min(ThrottleLevel + 1, TDSScheduler::MaxThrottleLevel);
+	}
+	else if(SmoothedLoad < ThrottleDownLoad)
+	{
+		NewLevel = FMath::Max(ThrottleLevel - 1, 0);
+	}
+	if(NewLevel == ThrottleLevel) return;
+
+	UE_LOG(LogTDSScheduler, Log, TEXT("Throttle level %d -> %d at %.0f%% of the frame budget"), ThrottleLevel, NewLevel, SmoothedLoad * 100.0f);
+
+	ThrottleLevel = NewLevel;
+	LastThrottleChangeTime = Now;
+	ApplyNetUpdateFrequencies();
+}
+
+void UTDSSimulationScheduler::ApplyNetUpdateFrequencies()
+{
+	NetActors.RemoveAll([](const FNetActor& NetActor) { return !NetActor.Actor.IsValid(); });
+
+	for(const FNetActor& NetActor : NetActors)
+	{
+		NetActor.Actor->NetUpdateFrequency = NetActor.BaseFrequency / GetStepInterval(NetActor.Priority);
+	}
+}
+
+void UTDSSimulationScheduler::LogStats() const
+{
+	UE_LOG(LogTDSScheduler, Display, TEXT("%s, headroom %.0f%%, throttle level %d, %u steps, %.2f s dropped, %d net actors"),
+		bFixedStep ? *FString::Printf(TEXT("Fixed step %.1f ms"), GetFixedStep() * 1000.0f) : TEXT("Per frame"),
+		GetHeadroom() * 100.0f, ThrottleLevel, StepCount, DroppedTime, NetActors.Num());
+
+	for(const FScheduledSystem& System : Systems)
+	{
+		UE_LOG(LogTDSScheduler, Display, TEXT("  %-24s %-8s every %d steps"), *System.Name.ToString(), TDSScheduler::GetPriorityName(System.Priority), GetStepInterval(System.Priority));
+	}
+}
@@ -0,0 +1,143 @@
+// Copyright, The Lounge
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "TDSSimulationScheduler.generated.h"
+
+DECLARE_LOG_CATEGORY_EXTERN(LogTDSScheduler, Log, All);
+
+/** Order in which work is slowed down when the server runs out of frame time, lowest first. */
+UENUM(BlueprintType)
+enum class ETDSSchedulePriority : uint8
+{
+	/** Every step, never throttled. Gameplay results depend on it. */
+	Critical,
+	High,
+	Normal,
+	/** First to be throttled, cosmetic or informational work. */
+	Low
+};
+
+/** Receives the simulated time since the system last ran, a multiple of the fixed step on the server. */
+DECLARE_DELEGATE_OneParam(FTDSScheduledStep, float);
+
+/**
+ * Runs TDS gameplay systems at a fixed simulation step on the server, decoupled from the frame and net tick rate.
+ * The Critical systems are the weapons' fire clocks and remote shot validation, damage resolution of the trace
+ * batch and the periods of periodic gameplay effects such as shield regen. Character movement is not stepped.
+ * Frames that take longer run several steps, up to MaxStepsPerFrame; time beyond that is dropped from all stepped
+ * systems alike, slowing fire, damage and regen for every player instead of letting the server spiral.
+ * Clients and standalone worlds run each system once per frame.
+ *
+ * Headroom is the smoothed share of the frame budget left, measured from the start of the world tick to the end of
+ * the net driver's flush. When it runs low the throttle level rises one priority at a time: systems below Critical
+ * run every 2, 4 or 8 steps and the NetUpdateFrequency of the registered actors is divided likewise, Low first.
+ * TDS.Scheduler.Stats logs the current state.
+ */
+UCLASS(config=Game)
+class TDS_API UTDSSimulationScheduler : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	/** Systems run in priority order, then in registration order. Names are unique, registering again replaces. */
+	void RegisterSystem(FName Name, ETDSSchedulePriority Priority, FTDSScheduledStep Step);
+	void UnregisterSystem(FName Name);
+
+	/** Scales the actor's class default NetUpdateFrequency with the throttle level. Server only. */
+	void RegisterNetActor(AActor* Actor, ETDSSchedulePriority Priority);
+
+	/** Share of the frame budget left, 1 when idle, negative when over budget. */
+	UFUNCTION(BlueprintPure, Category = "Scheduler")
+	float GetHeadroom() const { return 1.0f - SmoothedLoad; }
+
+	UFUNCTION(BlueprintPure, Category = "Scheduler")
+	int32 GetThrottleLevel() const { return ThrottleLevel; }
+
+	/** Whether systems run at the fixed step and load throttles them, true on servers. */
+	bool IsFixedStep() const;
+	float GetFixedStep() const { return 1.0f / FMath::Max(SimulationRate, 1.0f); }
+
+	/** Steps between two runs of a system of this priority at the current throttle level. */
+	int32 GetStepInterval(ETDSSchedulePriority Priority) const;
+
+	void LogStats() const;
+
+protected:
+	/** Fixed simulation steps per second on the server. */
+	UPROPERTY(Config)
+	float SimulationRate{60.0f};
+
+	/** Catch-up limit for a long frame. */
+	UPROPERTY(Config)
+	int32 MaxStepsPerFrame{8};
+
+	/** Frame rate the server is expected to hold, its frame time is the budget headroom is measured against. */
+	UPROPERTY(Config)
+	float TargetFrameRate{30.0f};
+
+	/** Load, the smoothed share of the budget used, above which the throttle level rises. */
+	UPROPERTY(Config)
+	float ThrottleUpLoad{0.85f};
+
+	/** Load below which the throttle level falls. */
+	UPROPERTY(Config)
+	float ThrottleDownLoad{0.6f};
+
+	/** Seconds between two throttle level changes. */
+	UPROPERTY(Config)
+	float ThrottleHoldTime{1.0f};
+
+	/** Weight of the latest frame in the smoothed load. */
+	UPROPERTY(Config)
+	float LoadSmoothing{0.1f};
+
+private:
+	struct FScheduledSystem
+	{
+		FName Name;
+		ETDSSchedulePriority Priority{ETDSSchedulePriority::Critical};
+		FTDSScheduledStep Step;
+		float PendingTime{0.0f};
+	};
+
+	struct FNetActor
+	{
+		TWeakObjectPtr<AActor> Actor;
+		ETDSSchedulePriority Priority{ETDSSchedulePriority::Critical};
+		float BaseFrequency{0.0f};
+	};
+
+	void RunStep(float StepTime);
+	void RemoveUnboundSystems();
+
+	void OnWorldTickStart(UWorld* InWorld, ELevelTick TickType, float DeltaTime);
+	void OnPostTickFlush();
+	void UpdateThrottleLevel(float LoadSample);
+	void ApplyNetUpdateFrequencies();
+
+	TArray<FScheduledSystem> Systems;
+	TArray<FScheduledSystem> PendingSystems;
+	TArray<FNetActor> NetActors;
+
+	bool bFixedStep{false};
+	bool bRunningSystems{false};
+	float Accumulator{0.0f};
+	uint32 StepCount{0};
+
+	double WorldTickStartTime{0.0};
+	float SmoothedLoad{0.0f};
+	int32 ThrottleLevel{0};
+	double LastThrottleChangeTime{0.0};
+	float DroppedTime{0.0f};
+
+	FDelegateHandle TickStartHandle;
+	FDelegateHandle PostTickFlushHandle;
+};
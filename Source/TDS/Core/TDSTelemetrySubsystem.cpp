@@ -0,0 +1,235 @@
+// Copyright, The Lounge
+
+
+#include "TDSTelemetrySubsystem.h"
+#include "Engine/Engine.h"
+#include "Engine/GameInstance.h"
+#include "Engine/World.h"
+#include "GenericPlatform/GenericPlatformFile.h"
+#include "HAL/Event.h"
+#include "HAL/PlatformFileManager.h"
+#include "HAL/RunnableThread.h"
+#include "Misc/DateTime.h"
+#include "Misc/Paths.h"
+
+DEFINE_LOG_CATEGORY(LogTDSTelemetry);
+
+#pragma region Ring
+FTDSTelemetryRing::FTDSTelemetryRing(uint32 InCapacity)
+{
+	const uint64 Capacity = FMath::RoundUpToPowerOfTwo(FMath::Max<uint32>(InCapacity, 2));
+	Mask = Capacity - 1;
+	Cells = MakeUnique<FCell[]>(Capacity);
+	for(uint64 Index = 0; Index < Capacity; ++Index)
+	{
+		Cells[Index].Sequence.store(Index, std::memory_order_relaxed);
+	}
+}
+
+bool FTDSTelemetryRing::Push(const FTDSTelemetryEvent& Event)
+{
+	// Each cell's sequence tells whose turn it is: equal to the position when free to write,
+	// position + 1 once written and ready to read
+	uint64 Position = EnqueuePosition.load(std::memory_order_relaxed);
+	for(;;)
+	{
+		FCell& Cell = Cells[Position & Mask];
+		const uint64 Sequence = Cell.Sequence.load(std::memory_order_acquire);
+		const int64 Difference = static_cast<int64>(Sequence) - static_cast<int64>(Position);
+		if(Difference == 0)
+		{
+			if(EnqueuePosition.compare_exchange_weak(Position, Position + 1, std::memory_order_relaxed))
+			{
+				Cell.Event = Event;
+				Cell.Sequence.store(Position + 1, std::memory_order_release);
+				return true;
+			}
+		}
+		else if(Difference < 0)
+		{
+			// The consumer has not freed this cell yet, the ring is full
+			return false;
+		}
+		else
+		{
+			Position = EnqueuePosition.load(std::memory_order_relaxed);
+		}
+	}
+}
+
+bool FTDSTelemetryRing::Pop(FTDSTelemetryEvent& OutEvent)
+{
+	const uint64 Position = DequeuePosition.load(std::memory_order_relaxed);
+	FCell& Cell = Cells[Position & Mask];
+	const uint64 Sequence = Cell.Sequence.load(std::memory_order_acquire);
+	if(Sequence != Position + 1) return false;
+
+	// Single consumer, no need to race for the position
+	OutEvent = Cell.Event;
+	DequeuePosition.store(Position + 1, std::memory_order_relaxed);
+	Cell.Sequence.store(Position + Mask + 1, std::memory_order_release);
+	return true;
+}
+#pragma endregion Ring
+
+namespace TDSTelemetry
+{
+	static const TCHAR* GetEventName(ETDSTelemetryEvent Type)
+	{
+		switch(Type)
+		{
+		case ETDSTelemetryEvent::Damage: return TEXT("damage");
+		case ETDSTelemetryEvent::Kill: return TEXT("kill");
+		case ETDSTelemetryEvent::AbilityActivated: return TEXT("ability");
+		case ETDSTelemetryEvent::DestructibleDeath: return TEXT("destructible_death");
+		}
+		return TEXT("unknown");
+	}
+}
+
+void UTDSTelemetrySubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	if(!bEnabled) return;
+
+	Ring = MakeUnique<FTDSTelemetryRing>(static_cast<uint32>(FMath::Max(RingCapacity, 2)));
+	SessionName = FDateTime::Now().ToString();
+	bStopping = false;
+
+	WakeEvent = FPlatformProcess::GetSynchEventFromPool(false);
+	WriterThread = FRunnableThread::Create(this, TEXT("TDSTelemetryWriter"), 0, TPri_BelowNormal);
+}
+
+void UTDSTelemetrySubsystem::Deinitialize()
+{
+	if(WriterThread)
+	{
+		// Kill calls Stop and waits, the writer drains what is left before exiting
+		WriterThread->Kill(true);
+		delete WriterThread;
+		WriterThread = nullptr;
+	}
+
+	if(WakeEvent)
+	{
+		FPlatformProcess::ReturnSynchEventToPool(WakeEvent);
+		WakeEvent = nullptr;
+	}
+
+	Ring.Reset();
+
+	Super::Deinitialize();
+}
+
+void UTDSTelemetrySubsystem::Record(const UObject* WorldContextObject, FTDSTelemetryEvent Event)
+{
+	UWorld* World = GEngine ? GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::ReturnNull) : nullptr;
+	UGameInstance* GameInstance = World ? World->GetGameInstance() : nullptr;
+	UTDSTelemetrySubsystem* Telemetry = GameInstance ? GameInstance->GetSubsystem<UTDSTelemetrySubsystem>() : nullptr;
+	if(!Telemetry) return;
+
+	Event.Time = World->GetTimeSeconds();
+	Telemetry->Push(Event);
+}
+
+bool UTDSTelemetrySubsystem::Push(const FTDSTelemetryEvent& Event)
+{
+	if(!Ring || bStopping.load(std::memory_order_relaxed)) return false;
+
+	if(!Ring->Push(Event))
+	{
+		DroppedEvents.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+	return true;
+}
+
+#pragma region Writer thread
+uint32 UTDSTelemetrySubsystem::Run()
+{
+	const uint32 WaitMs = static_cast<uint32>(FMath::Max(FlushInterval, 0.01f) * 1000.0f);
+	while(!bStopping.load(std::memory_order_acquire))
+	{
+		WakeEvent->Wait(WaitMs);
+		DrainToFile();
+	}
+
+	DrainToFile();
+	CloseFile();
+	return 0;
+}
+
+void UTDSTelemetrySubsystem::Stop()
+{
+	bStopping.store(true, std::memory_order_release);
+	if(WakeEvent)
+	{
+		WakeEvent->Trigger();
+	}
+}
+
+void UTDSTelemetrySubsystem::DrainToFile()
+{
+	FTDSTelemetryEvent Event;
+	while(Ring->Pop(Event))
+	{
+		WriteLine(FString::Printf(TEXT("{\"t\":%.3f,\"type\":\"%s\",\"instigator\":\"%s\",\"target\":\"%s\",\"subject\":\"%s\",\"value\":%.2f,\"loc\":[%.0f,%.0f,%.0f]}\n"),
+			Event.Time, TDSTelemetry::GetEventName(Event.Type), *Event.Instigator.ToString(), *Event.Target.ToString(), *Event.Subject.ToString(),
+			Event.Value, Event.Location.X, Event.Location.Y, Event.Location.Z));
+	}
+
+	const uint32 Dropped = DroppedEvents.load(std::memory_order_relaxed);
+	if(Dropped != ReportedDrops)
+	{
+		WriteLine(FString::Printf(TEXT("{\"type\":\"dropped\",\"count\":%u,\"total\":%u}\n"), Dropped - ReportedDrops, Dropped));
+		UE_LOG(LogTDSTelemetry, Warning, TEXT("Telemetry ring full, dropped %u events"), Dropped - ReportedDrops);
+		ReportedDrops = Dropped;
+	}
+
+	if(File)
+	{
+		File->Flush();
+	}
+}
+
+void UTDSTelemetrySubsystem::WriteLine(const FString& Line)
+{
+	if(File && FileSize >= static_cast<int64>(MaxFileSizeMB) * 1024 * 1024)
+	{
+		CloseFile();
+	}
+	if(!File && !OpenNextFile()) return;
+
+	const FTCHARToUTF8 Utf8Line(*Line);
+	if(File->Write(reinterpret_cast<const uint8*>(Utf8Line.Get()), Utf8Line.Length()))
+	{
+		FileSize += Utf8Line.Length();
+	}
+}
+
+bool UTDSTelemetrySubsystem::OpenNextFile()
+{
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+
+	const FString Directory = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("Telemetry"));
+	PlatformFile.CreateDirectoryTree(*Directory);
+
+	const FString FilePath = FPaths::Combine(Directory, FString::Printf(TEXT("Telemetry-%s-%d.jsonl"), *SessionName, FileIndex++));
+	File = PlatformFile.OpenWrite(*FilePath);
+	FileSize = 0;
+
+	if(!File)
+	{
+		UE_LOG(LogTDSTelemetry, Error, TEXT("Could not open telemetry file %s"), *FilePath);
+		return false;
+	}
+	return true;
+}
+
+void UTDSTelemetrySubsystem::CloseFile()
+{
+	delete File;
+	File = nullptr;
+}
+#pragma endregion Writer thread
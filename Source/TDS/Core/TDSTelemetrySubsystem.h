@@ -0,0 +1,128 @@
+// Copyright, The Lounge
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+#include "Subsystems/GameInstanceSubsystem.h"
+#include <atomic>
+#include "TDSTelemetrySubsystem.generated.h"
+
+class FRunnableThread;
+class IFileHandle;
+
+DECLARE_LOG_CATEGORY_EXTERN(LogTDSTelemetry, Log, All);
+
+enum class ETDSTelemetryEvent : uint8
+{
+	Damage,
+	Kill,
+	AbilityActivated,
+	DestructibleDeath
+};
+
+/**
+ * Fixed-size telemetry record. Only names and plain values, so pushing one never allocates
+ * and the writer thread can format it without touching the actors.
+ */
+struct FTDSTelemetryEvent
+{
+	ETDSTelemetryEvent Type{ETDSTelemetryEvent::Damage};
+	float Time{0.0f};
+	float Value{0.0f};
+	FVector3f Location{FVector3f::ZeroVector};
+	FName Instigator;
+	FName Target;
+
+	/** Effect or ability class that caused the event. */
+	FName Subject;
+};
+
+/**
+ * Bounded lock-free ring, any thread may push, one thread pops.
+ * A full ring rejects the push instead of waiting for the consumer.
+ */
+class FTDSTelemetryRing
+{
+public:
+	/** Capacity is rounded up to a power of two. */
+	explicit FTDSTelemetryRing(uint32 InCapacity);
+
+	bool Push(const FTDSTelemetryEvent& Event);
+	bool Pop(FTDSTelemetryEvent& OutEvent);
+
+private:
+	struct FCell
+	{
+		std::atomic<uint64> Sequence{0};
+		FTDSTelemetryEvent Event;
+	};
+
+	TUniquePtr<FCell[]> Cells;
+	uint64 Mask{0};
+
+	// Producers and the consumer each own a cache line
+	alignas(PLATFORM_CACHE_LINE_SIZE) std::atomic<uint64> EnqueuePosition{0};
+	alignas(PLATFORM_CACHE_LINE_SIZE) std::atomic<uint64> DequeuePosition{0};
+};
+
+/**
+ * Gameplay telemetry for balancing and ops dashboards. The game thread pushes records into a lock-free ring,
+ * a background thread drains it into rotating JSON-lines files in Saved/Telemetry. Records pushed while the
+ * ring is full are dropped and counted, the count is written to the file as its own record.
+ */
+UCLASS(config=Game)
+class TDS_API UTDSTelemetrySubsystem : public UGameInstanceSubsystem, public FRunnable
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	/** Time stamps and queues the event on the world's telemetry, a no-op when telemetry is disabled. */
+	static void Record(const UObject* WorldContextObject, FTDSTelemetryEvent Event);
+
+	bool Push(const FTDSTelemetryEvent& Event);
+
+	uint32 GetDroppedEvents() const { return DroppedEvents.load(std::memory_order_relaxed); }
+
+	// FRunnable, the writer thread
+	virtual uint32 Run() override;
+	virtual void Stop() override;
+
+protected:
+	UPROPERTY(Config)
+	bool bEnabled{true};
+
+	UPROPERTY(Config)
+	int32 RingCapacity{8192};
+
+	/** Seconds between writer wake ups. */
+	UPROPERTY(Config)
+	float FlushInterval{0.5f};
+
+	/** A new file is started once the current one reaches this size. */
+	UPROPERTY(Config)
+	int32 MaxFileSizeMB{64};
+
+private:
+	void DrainToFile();
+	bool OpenNextFile();
+	void CloseFile();
+	void WriteLine(const FString& Line);
+
+	TUniquePtr<FTDSTelemetryRing> Ring;
+	std::atomic<uint32> DroppedEvents{0};
+
+	FRunnableThread* WriterThread{nullptr};
+	FEvent* WakeEvent{nullptr};
+	std::atomic<bool> bStopping{false};
+
+	// Writer thread only
+	IFileHandle* File{nullptr};
+	int64 FileSize{0};
+	int32 FileIndex{0};
+	FString SessionName;
+	uint32 ReportedDrops{0};
+};
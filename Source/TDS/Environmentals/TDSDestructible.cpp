@@ -2,6 +2,9 @@
 
 
 #include "TDSDestructible.h"
+#include "../GASCore/TDSReplicationPolicy.h"
+#include "../GASCore/TDSPeriodicEffectSubsystem.h"
+#include "../Core/TDSSimulationScheduler.h"
 
 // Sets default values
 ATDSDestructible::ATDSDestructible()
@@ -13,9 +16,10 @@ ATDSDestructible::ATDSDestructible()
 	RootComponent = StaticMesh;
 
 	AbilitySystemComponent = CreateDefaultSubobject<UAbilitySystemComponent>("AbilitySystemComponent");
-	AbilitySystemComponent->SetIsReplicated(true);
+	TDSReplicationPolicy::ConfigureWorldASC(AbilitySystemComponent);
 
 	HealthSet = CreateDefaultSubobject<UTDSHealthSet>("HealthSet");
+	CombatSet = CreateDefaultSubobject<UTDSCombatSet>("CombatSet");
 }
 
 // Called when the game starts or when spawned
@@ -23,9 +27,22 @@ void ATDSDestructible::BeginPlay()
 {
 	Super::BeginPlay();
 
+	if(UTDSSimulationScheduler* Scheduler = GetWorld() ? GetWorld()->GetSubsystem<UTDSSimulationScheduler>() : nullptr)
+	{
+		Scheduler->RegisterNetActor(this, ETDSSchedulePriority::Low);
+	}
+	if(UTDSPeriodicEffectSubsystem* PeriodicEffects = GetWorld() ? GetWorld()->GetSubsystem<UTDSPeriodicEffectSubsystem>() : nullptr)
+	{
+		PeriodicEffects->Register(AbilitySystemComponent);
+	}
+
 	if(!AbilitySystemComponent) return;
 
-	AbilitySystemComponent->GetGameplayAttributeValueChangeDelegate(HealthSet->GetHealthAttribute()).AddUObject(this, &ATDSDestructible::OnHealthAttributeChanged);
+	bHasLegacyHealthEvent = GetClass()->IsFunctionImplementedInScript(GET_FUNCTION_NAME_CHECKED(ATDSDestructible, OnHealthChanged));
+
+	VitalsViewModel = NewObject<UTDSVitalsViewModel>(this, TEXT("VitalsViewModel"));
+	VitalsViewModel->OnVitalsChangedNative.AddUObject(this, &ATDSDestructible::HandleVitalsChanged);
+	VitalsViewModel->Bind(AbilitySystemComponent);
 }
 
 UAbilitySystemComponent* ATDSDestructible::GetAbilitySystemComponent() const
@@ -33,9 +50,14 @@ UAbilitySystemComponent* ATDSDestructible::GetAbilitySystemComponent() const
 	return AbilitySystemComponent;
 }
 
-void ATDSDestructible::OnHealthAttributeChanged(const FOnAttributeChangeData& Data)
+void ATDSDestructible::HandleVitalsChanged(const FTDSVitals& OldVitals, const FTDSVitals& NewVitals)
 {
-	OnHealthChanged(Data.OldValue, Data.NewValue);
+	OnVitalsChanged(OldVitals, NewVitals);
+
+	if(bHasLegacyHealthEvent && OldVitals.Health != NewVitals.Health)
+	{
+		OnHealthChanged(OldVitals.Health, NewVitals.Health);
+	}
 }
 
 
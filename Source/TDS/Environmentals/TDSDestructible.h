@@ -6,6 +6,8 @@
 #include "AbilitySystemComponent.h"
 #include "AbilitySystemInterface.h"
 #include "../GasCore/TDSHealthSet.h"
+#include "../GasCore/TDSCombatSet.h"
+#include "../UI/TDSVitalsViewModel.h"
 #include "GameFramework/Actor.h"
 #include "TDSDestructible.generated.h"
 
@@ -22,6 +24,9 @@ class TDS_API ATDSDestructible : public AActor, public IAbilitySystemInterface
 
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Mesh", meta = (AllowPrivateAccess = "true"))
 	UTDSHealthSet* HealthSet;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Mesh", meta = (AllowPrivateAccess = "true"))
+	UTDSCombatSet* CombatSet;
 	
 public:	
 	// Sets default values for this actor's properties
@@ -37,9 +42,23 @@ public:
 
 	UAbilitySystemComponent* GetAbilitySystemComponent() const override;
 
-	virtual void OnHealthAttributeChanged(const FOnAttributeChangeData& Data);
+	UFUNCTION(BlueprintPure, Category = "GAS")
+	UTDSVitalsViewModel* GetVitalsViewModel() const { return VitalsViewModel; }
 
+	virtual void HandleVitalsChanged(const FTDSVitals& OldVitals, const FTDSVitals& NewVitals);
+
+	/** Every health change of a frame, delivered once. */
+	UFUNCTION(BlueprintImplementableEvent, Category = "GAS")
+	void OnVitalsChanged(const FTDSVitals& OldVitals, const FTDSVitals& NewVitals);
+
+	/** Only fired for Blueprints that still implement it. Prefer OnVitalsChanged. */
 	UFUNCTION(BlueprintImplementableEvent, Category = "GAS")
 	void OnHealthChanged(float OldValue, float NewValue);
 
+private:
+	UPROPERTY(Transient)
+	UTDSVitalsViewModel* VitalsViewModel;
+
+	bool bHasLegacyHealthEvent{false};
+
 };
@@ -2,10 +2,107 @@
 
 
 #include "TDSBaseSet.h"
+#include "Net/UnrealNetwork.h"
+
+namespace TDSAttributeTables
+{
+	FCriticalSection Lock;
+	TMap<const UClass*, TUniquePtr<FTDSAttributeTable>> TablesByClass;
+}
+
+FTDSAttributeMetadata& FTDSAttributeMetadata::Clamp(float InMinValue, const FGameplayAttribute& InMaxAttribute)
+{
+	bClamp = true;
+	MinValue = InMinValue;
+	MaxAttribute = InMaxAttribute;
+	return *this;
+}
+
+FTDSAttributeMetadata& FTDSAttributeMetadata::Clamp(float InMinValue, float InMaxValue)
+{
+	bClamp = true;
+	MinValue = InMinValue;
+	MaxValue = InMaxValue;
+	return *this;
+}
+
+FTDSAttributeMetadata& FTDSAttributeMetadata::Replicate(ELifetimeCondition Condition)
+{
+	ReplicationCondition = Condition;
+	return *this;
+}
+
+FTDSAttributeMetadata& FTDSAttributeTable::Declare(const FGameplayAttribute& Attribute)
+{
+	check(Attribute.IsValid());
+
+	if(const int32* Index = IndexByProperty.Find(Attribute.GetUProperty()))
+	{
+		return Entries[*Index];
+	}
+
+	IndexByProperty.Add(Attribute.GetUProperty(), Entries.Num());
+	FTDSAttributeMetadata& Metadata = Entries.AddDefaulted_GetRef();
+	Metadata.Attribute = Attribute;
+	return Metadata;
+}
+
+void UTDSBaseSet::PostInitProperties()
+{
+	Super::PostInitProperties();
+
+	GetAttributeTable();
+}
+
+const FTDSAttributeTable& UTDSBaseSet::GetAttributeTable() const
+{
+	if(!AttributeTable)
+	{
+		FScopeLock ScopeLock(&TDSAttributeTables::Lock);
+
+		TUniquePtr<FTDSAttributeTable>& Table = TDSAttributeTables::TablesByClass.FindOrAdd(GetClass());
+		if(!Table)
+		{
+			Table = MakeUnique<FTDSAttributeTable>();
+			DeclareAttributes(*Table);
+		}
+		AttributeTable = Table.Get();
+	}
+	return *AttributeTable;
+}
+
+void UTDSBaseSet::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	for(const FTDSAttributeMetadata& Metadata : GetAttributeTable().GetEntries())
+	{
+		const FProperty* Property = Metadata.Attribute.GetUProperty();
+		if(!Property->HasAnyPropertyFlags(CPF_Net)) continue;
+
+		FDoRepLifetimeParams Params;
+		Params.Condition = Metadata.ReplicationCondition;
+		Params.RepNotifyCondition = REPNOTIFY_Always;
+		RegisterReplicatedLifetimeProperty(Property, OutLifetimeProps, Params);
+	}
+}
+
+void UTDSBaseSet::DeclareAttributes(FTDSAttributeTable& Table) const
+{
+
+}
 
 void UTDSBaseSet::ClampAttributeOnChange(const FGameplayAttribute& Attribute, float& NewValue) const
 {
-	
+	const FTDSAttributeMetadata* Metadata = GetAttributeTable().Find(Attribute);
+	if(!Metadata || !Metadata->bClamp) return;
+
+	float MaxValue = Metadata->MaxValue;
+	if(Metadata->MaxAttribute.IsValid())
+	{
+		MaxValue = FMath::Min(MaxValue, Metadata->MaxAttribute.GetNumericValue(this));
+	}
+	NewValue = FMath::Clamp(NewValue, Metadata->MinValue, MaxValue);
 }
 
 void UTDSBaseSet::PreAttributeBaseChange(const FGameplayAttribute& Attribute, float& NewValue) const
@@ -20,4 +117,4 @@ void UTDSBaseSet::PreAttributeChange(const FGameplayAttribute& Attribute, float&
 	Super::PreAttributeChange(Attribute, NewValue);
 
 	ClampAttributeOnChange(Attribute, NewValue);
-}
\ No newline at end of file
+}
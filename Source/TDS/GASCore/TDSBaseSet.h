@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "AttributeSet.h"
+#include "UObject/CoreNetTypes.h"
 #include "TDSBaseSet.generated.h"
 
 /**
@@ -16,16 +17,74 @@
 	GAMEPLAYATTRIBUTE_VALUE_SETTER(PropertyName) \
 	GAMEPLAYATTRIBUTE_VALUE_INITTER(PropertyName)
 
+// Body of an attribute's OnRep_ function. The UFUNCTION declaration stays in the header for UHT.
+#define ATTRIBUTE_REPNOTIFY(ClassName, PropertyName) \
+	void ClassName::OnRep_##PropertyName(const FGameplayAttributeData& Old##PropertyName) \
+	{ \
+		GAMEPLAYATTRIBUTE_REPNOTIFY(ClassName, PropertyName, Old##PropertyName); \
+	}
 
+/**
+ * Clamping and replication of one attribute, declared once in UTDSBaseSet::DeclareAttributes.
+ */
+struct TDS_API FTDSAttributeMetadata
+{
+	FGameplayAttribute Attribute;
+
+	/** Upper bound taken from the current value of another attribute of the same set. */
+	FGameplayAttribute MaxAttribute;
+	float MinValue{-FLT_MAX};
+	float MaxValue{FLT_MAX};
+	bool bClamp{false};
+
+	ELifetimeCondition ReplicationCondition{COND_None};
+
+	FTDSAttributeMetadata& Clamp(float InMinValue, const FGameplayAttribute& InMaxAttribute);
+	FTDSAttributeMetadata& Clamp(float InMinValue, float InMaxValue);
+	FTDSAttributeMetadata& Replicate(ELifetimeCondition Condition);
+};
+
+/**
+ * Attribute metadata of one attribute set class, built once and shared by every instance.
+ */
+class TDS_API FTDSAttributeTable
+{
+public:
+	FTDSAttributeMetadata& Declare(const FGameplayAttribute& Attribute);
+
+	const FTDSAttributeMetadata* Find(const FGameplayAttribute& Attribute) const
+	{
+		const int32* Index = IndexByProperty.Find(Attribute.GetUProperty());
+		return Index ? &Entries[*Index] : nullptr;
+	}
+
+	TConstArrayView<FTDSAttributeMetadata> GetEntries() const { return Entries; }
+
+private:
+	TArray<FTDSAttributeMetadata> Entries;
+	TMap<const FProperty*, int32> IndexByProperty;
+};
 
 UCLASS()
 class TDS_API UTDSBaseSet : public UAttributeSet
 {
 	GENERATED_BODY()
 
+public:
+	virtual void PostInitProperties() override;
+	virtual void GetLifetimeReplicatedProps(TArray< FLifetimeProperty > & OutLifetimeProps) const override;
+
+	const FTDSAttributeTable& GetAttributeTable() const;
+
 protected:
 	virtual void PreAttributeBaseChange(const FGameplayAttribute& Attribute, float& NewValue) const override;
 	virtual void PreAttributeChange(const FGameplayAttribute& Attribute, float& NewValue) override;
-	
+
 	virtual void ClampAttributeOnChange(const FGameplayAttribute& Attribute, float& NewValue) const;
+
+	/** Declares clamping and replication of every attribute in the set. Called once per class. */
+	virtual void DeclareAttributes(FTDSAttributeTable& Table) const;
+
+private:
+	mutable const FTDSAttributeTable* AttributeTable{nullptr};
 };
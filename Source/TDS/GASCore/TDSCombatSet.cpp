@@ -0,0 +1,28 @@
+// Copyright, The Lounge
+
+
+#include "TDSCombatSet.h"
+
+UTDSCombatSet::UTDSCombatSet() : Armor(0.0f), DamageResistance(0.0f), CritChance(0.0f), CritMultiplier(1.5f)
+{
+
+}
+
+void UTDSCombatSet::DeclareAttributes(FTDSAttributeTable& Table) const
+{
+	Table.Declare(GetArmorAttribute()).Clamp(0.0f, FLT_MAX);
+	Table.Declare(GetDamageResistanceAttribute()).Clamp(0.0f, 1.0f);
+
+	// Only the shooter reads its own crit values, armor and resistance are needed by everyone predicting hits
+	Table.Declare(GetCritChanceAttribute()).Clamp(0.0f, 1.0f).Replicate(COND_OwnerOnly);
+	Table.Declare(GetCritMultiplierAttribute()).Clamp(1.0f, FLT_MAX).Replicate(COND_OwnerOnly);
+}
+
+#pragma region Replication, registered from the attribute table
+
+ATTRIBUTE_REPNOTIFY(UTDSCombatSet, Armor)
+ATTRIBUTE_REPNOTIFY(UTDSCombatSet, DamageResistance)
+ATTRIBUTE_REPNOTIFY(UTDSCombatSet, CritChance)
+ATTRIBUTE_REPNOTIFY(UTDSCombatSet, CritMultiplier)
+
+#pragma endregion
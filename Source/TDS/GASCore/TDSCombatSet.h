@@ -0,0 +1,53 @@
+// Copyright, The Lounge
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "TDSBaseSet.h"
+#include "AbilitySystemComponent.h"
+#include "TDSCombatSet.generated.h"
+
+/**
+ * Damage modifiers read by UTDSDamageExecution. Armor and DamageResistance apply when receiving damage,
+ * CritChance and CritMultiplier when dealing it.
+ */
+UCLASS()
+class TDS_API UTDSCombatSet : public UTDSBaseSet
+{
+	GENERATED_BODY()
+
+public:
+	UTDSCombatSet();
+
+	UPROPERTY(BlueprintReadOnly, ReplicatedUsing = OnRep_Armor, Category = "Attributes", meta = (AllowPrivateAccess = true))
+	FGameplayAttributeData Armor;
+	ATTRIBUTE_ACCESSORS(UTDSCombatSet, Armor);
+
+	/** Fraction of incoming damage ignored, 0 to 1. */
+	UPROPERTY(BlueprintReadOnly, ReplicatedUsing = OnRep_DamageResistance, Category = "Attributes", meta = (AllowPrivateAccess = true))
+	FGameplayAttributeData DamageResistance;
+	ATTRIBUTE_ACCESSORS(UTDSCombatSet, DamageResistance);
+
+	UPROPERTY(BlueprintReadOnly, ReplicatedUsing = OnRep_CritChance, Category = "Attributes", meta = (AllowPrivateAccess = true))
+	FGameplayAttributeData CritChance;
+	ATTRIBUTE_ACCESSORS(UTDSCombatSet, CritChance);
+
+	UPROPERTY(BlueprintReadOnly, ReplicatedUsing = OnRep_CritMultiplier, Category = "Attributes", meta = (AllowPrivateAccess = true))
+	FGameplayAttributeData CritMultiplier;
+	ATTRIBUTE_ACCESSORS(UTDSCombatSet, CritMultiplier);
+
+protected:
+	virtual void DeclareAttributes(FTDSAttributeTable& Table) const override;
+
+	UFUNCTION()
+	virtual void OnRep_Armor(const FGameplayAttributeData& OldArmor);
+
+	UFUNCTION()
+	virtual void OnRep_DamageResistance(const FGameplayAttributeData& OldDamageResistance);
+
+	UFUNCTION()
+	virtual void OnRep_CritChance(const FGameplayAttributeData& OldCritChance);
+
+	UFUNCTION()
+	virtual void OnRep_CritMultiplier(const FGameplayAttributeData& OldCritMultiplier);
+};
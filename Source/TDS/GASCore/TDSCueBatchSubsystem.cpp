@@ -0,0 +1,186 @@
+// Copyright, The Lounge
+
+
+#include "TDSCueBatchSubsystem.h"
+#include "AbilitySystemGlobals.h"
+#include "GameplayCueManager.h"
+#include "Components/SceneComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerController.h"
+#include "../Character/TDSPlayerState.h"
+#include "../Core/TDSSimulationScheduler.h"
+
+void UTDSCueBatchSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	UTDSSimulationScheduler* Scheduler = InWorld.GetSubsystem<UTDSSimulationScheduler>();
+	if(!Scheduler) return;
+
+	// Only worlds with a local player show cues
+	if(InWorld.GetNetMode() != NM_DedicatedServer)
+	{
+		Scheduler->RegisterSystem(TEXT("CuePreallocation"), ETDSSchedulePriority::Low, FTDSScheduledStep::CreateUObject(this, &UTDSCueBatchSubsystem::UpdateCuePreallocation));
+	}
+
+	// Cosmetic but seen by everyone, slowed down after the net updates of world actors and at most to every 4 steps
+	if(InWorld.GetNetMode() != NM_Client)
+	{
+		Scheduler->RegisterSystem(TEXT("CueBatch"), ETDSSchedulePriority::Normal, FTDSScheduledStep::CreateUObject(this, &UTDSCueBatchSubsystem::SendQueuedCues));
+	}
+}
+
+void UTDSCueBatchSubsystem::UpdateCuePreallocation(float DeltaTime)
+{
+	// The manager spawns one missing instance per call, it expects the game to call it every frame
+	if(UGameplayCueManager* CueManager = UAbilitySystemGlobals::Get().GetGameplayCueManager())
+	{
+		CueManager->UpdatePreallocation(GetWorld());
+	}
+}
+
+void UTDSCueBatchSubsystem::SendQueuedCues(float DeltaTime)
+{
+	UWorld* World = GetWorld();
+	if(!World || QueuedCues.Num() == 0) return;
+
+	const float CullDistanceSquared = FMath::Square(CullDistance);
+	for(FConstPlayerControllerIterator It = World->GetPlayerControllerIterator(); It; ++It)
+	{
+		APlayerController* PlayerController = It->Get();
+		if(!PlayerController) continue;
+
+		FVector ViewLocation;
+		FRotator ViewRotation;
+		PlayerController->GetPlayerViewPoint(ViewLocation, ViewRotation);
+
+		ConnectionBatch.Reset();
+		for(const FQueuedCue& Cue : QueuedCues)
+		{
+			if(Cue.PredictedBy.Get() == PlayerController) continue;
+			if(FVector::DistSquared(ViewLocation, Cue.Entry.Location) > CullDistanceSquared) continue;
+
+			ConnectionBatch.Add(Cue.Entry);
+		}
+		if(ConnectionBatch.Num() == 0) continue;
+
+		// A listen server's own player plays its cues right here
+		if(PlayerController->IsLocalController())
+		{
+			ExecuteBatch(ConnectionBatch);
+			continue;
+		}
+
+		ATDSPlayerState* PlayerState = PlayerController->GetPlayerState<ATDSPlayerState>();
+		if(!PlayerState) continue;
+
+		const int32 BatchSize = FMath::Max(MaxEntriesPerBatch, 1);
+		if(ConnectionBatch.Num() <= BatchSize)
+		{
+			PlayerState->ClientReceiveCueBatch(ConnectionBatch);
+			continue;
+		}
+		for(int32 First = 0; First < ConnectionBatch.Num(); First += BatchSize)
+		{
+			PlayerState->ClientReceiveCueBatch(TArray<FTDSCueBatchEntry>(ConnectionBatch.GetData() + First, FMath::Min(BatchSize, ConnectionBatch.Num() - First)));
+		}
+	}
+
+	QueuedCues.Reset();
+}
+
+void UTDSCueBatchSubsystem::QueueCue(AActor* Target, FGameplayTag CueTag, FVector Location, FVector Normal, APawn* PredictedBy)
+{
+	if(!CueTag.IsValid() || !GetWorld() || GetWorld()->GetNetMode() == NM_Client) return;
+
+	FQueuedCue& Cue = QueuedCues.AddDefaulted_GetRef();
+	Cue.Entry.CueTag = CueTag;
+	Cue.Entry.Target = Target;
+	Cue.Entry.Location = Location;
+	Cue.Entry.Normal = Normal.GetSafeNormal();
+	Cue.PredictedBy = PredictedBy ? PredictedBy->GetController() : nullptr;
+}
+
+void UTDSCueBatchSubsystem::ExecuteCue(AActor* Target, const FGameplayTag& CueTag, const FVector& Location, const FVector& Normal)
+{
+	UGameplayCueManager* CueManager = UAbilitySystemGlobals::Get().GetGameplayCueManager();
+	if(!CueManager || !Target || !CueTag.IsValid()) return;
+
+	FGameplayCueParameters Parameters;
+	Parameters.Location = Location;
+	Parameters.Normal = Normal;
+	CueManager->HandleGameplayCue(Target, CueTag, EGameplayCueEvent::Executed, Parameters);
+}
+
+void UTDSCueBatchSubsystem::ExecuteCueAtLocation(const FGameplayTag& CueTag, const FVector& Location, const FVector& Normal)
+{
+	AActor* Anchor = AcquireCueAnchor();
+	if(!Anchor) return;
+
+	// Cue actors spawn at their target, the anchor is moved to the cue first
+	Anchor->SetActorLocationAndRotation(Location, Normal.IsNearlyZero() ? FRotator::ZeroRotator : Normal.Rotation());
+	ExecuteCue(Anchor, CueTag, Location, Normal);
+}
+
+void UTDSCueBatchSubsystem::ExecuteBatch(const TArray<FTDSCueBatchEntry>& Entries)
+{
+	for(const FTDSCueBatchEntry& Entry : Entries)
+	{
+		if(Entry.Target)
+		{
+			ExecuteCue(Entry.Target, Entry.CueTag, Entry.Location, Entry.Normal);
+		}
+		else
+		{
+			ExecuteCueAtLocation(Entry.CueTag, Entry.Location, Entry.Normal);
+		}
+	}
+}
+
+AActor* UTDSCueBatchSubsystem::AcquireCueAnchor()
+{
+	UWorld* World = GetWorld();
+	if(!World) return nullptr;
+
+	const double Now = World->GetTimeSeconds();
+
+	for(int32 Index = CueAnchors.Num() - 1; Index >= 0; --Index)
+	{
+		if(!IsValid(CueAnchors[Index]))
+		{
+			CueAnchors.RemoveAtSwap(Index);
+			CueAnchorUseTimes.RemoveAtSwap(Index);
+		}
+	}
+
+	int32 OldestIndex = INDEX_NONE;
+	for(int32 Index = 0; Index < CueAnchors.Num(); ++Index)
+	{
+		if(OldestIndex == INDEX_NONE || CueAnchorUseTimes[Index] < CueAnchorUseTimes[OldestIndex])
+		{
+			OldestIndex = Index;
+		}
+	}
+
+	// An anchor still carrying a cue would have its cue actor moved to the new one
+	const bool bOldestFree = OldestIndex != INDEX_NONE && Now - CueAnchorUseTimes[OldestIndex] >= AnchorReuseDelay;
+	if(bOldestFree || (OldestIndex != INDEX_NONE && CueAnchors.Num() >= FMath::Max(MaxCueAnchors, 1)))
+	{
+		CueAnchorUseTimes[OldestIndex] = Now;
+		return CueAnchors[OldestIndex];
+	}
+
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.ObjectFlags |= RF_Transient;
+	AActor* Anchor = World->SpawnActor<AActor>(SpawnParameters);
+	if(!Anchor) return nullptr;
+
+	USceneComponent* Root = NewObject<USceneComponent>(Anchor, TEXT("Root"));
+	Anchor->SetRootComponent(Root);
+	Root->RegisterComponent();
+
+	CueAnchors.Add(Anchor);
+	CueAnchorUseTimes.Add(Now);
+	return Anchor;
+}
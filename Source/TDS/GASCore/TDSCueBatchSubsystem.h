@@ -0,0 +1,105 @@
+// Copyright, The Lounge
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/NetSerialization.h"
+#include "GameplayTagContainer.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "TDSCueBatchSubsystem.generated.h"
+
+/** One executed gameplay cue as sent to clients. */
+USTRUCT()
+struct FTDSCueBatchEntry
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	FGameplayTag CueTag;
+
+	/** Actor the cue plays on, null on clients it is not relevant to, the cue then plays at Location alone. */
+	UPROPERTY()
+	AActor* Target{nullptr};
+
+	UPROPERTY()
+	FVector_NetQuantize Location;
+
+	UPROPERTY()
+	FVector_NetQuantizeNormal Normal;
+};
+
+/**
+ * Collects the executed gameplay cues raised on the server and sends them every run of its Normal priority
+ * UTDSSimulationScheduler system to every connection as one unreliable RPC, with quantized positions and
+ * normals and cues out of CullDistance left out, instead of one multicast per cue. A loaded server sends
+ * them less often.
+ *
+ * Clients execute them through the gameplay cue manager. Its notify actors are recycled, and the instances
+ * a cue class asks for with NumPreallocatedInstances are spawned ahead of time, one per run of a Low system.
+ */
+UCLASS(config=Game)
+class TDS_API UTDSCueBatchSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+
+	/**
+	 * Queues an executed cue for the next batch. Server only.
+	 * PredictedBy is the pawn that already played the cue locally, its player is skipped.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "GameplayCue", meta = (AdvancedDisplay = "PredictedBy"))
+	void QueueCue(AActor* Target, FGameplayTag CueTag, FVector Location, FVector Normal, APawn* PredictedBy = nullptr);
+
+	/** Plays a cue on this machine only, used for local prediction and received batches. */
+	static void ExecuteCue(AActor* Target, const FGameplayTag& CueTag, const FVector& Location, const FVector& Normal);
+
+	/**
+	 * Plays a cue on this machine only, at the location with no target actor of its own.
+	 * Each cue gets an anchor actor of its own from a small pool, cue actors are looked up per target.
+	 */
+	void ExecuteCueAtLocation(const FGameplayTag& CueTag, const FVector& Location, const FVector& Normal);
+
+	/** Plays a batch received from the server. */
+	void ExecuteBatch(const TArray<FTDSCueBatchEntry>& Entries);
+
+protected:
+	/** Cues further than this from a player's view are not sent to them. */
+	UPROPERTY(Config)
+	float CullDistance{10000.0f};
+
+	/** Entries per RPC, larger batches are split. */
+	UPROPERTY(Config)
+	int32 MaxEntriesPerBatch{64};
+
+	/** Seconds an anchor stays with its cue before another cue may take it, longer than burst cue actors live. */
+	UPROPERTY(Config)
+	float AnchorReuseDelay{2.0f};
+
+	/** Anchors kept at most, past it the longest unused one is taken early. */
+	UPROPERTY(Config)
+	int32 MaxCueAnchors{64};
+
+private:
+	struct FQueuedCue
+	{
+		FTDSCueBatchEntry Entry;
+		TWeakObjectPtr<const AController> PredictedBy;
+	};
+
+	void UpdateCuePreallocation(float DeltaTime);
+	void SendQueuedCues(float DeltaTime);
+
+	/** Stands in for targets that are not relevant here, the cue manager plays nothing without a target. */
+	AActor* AcquireCueAnchor();
+
+	TArray<FQueuedCue> QueuedCues;
+	TArray<FTDSCueBatchEntry> ConnectionBatch;
+
+	UPROPERTY(Transient)
+	TArray<AActor*> CueAnchors;
+
+	/** Last use of the anchor at the same index. */
+	TArray<double> CueAnchorUseTimes;
+};
@@ -0,0 +1,169 @@
+// Copyright, The Lounge
+
+
+#include "TDSDamageExecution.h"
+#include "AbilitySystemComponent.h"
+#include "TDSCombatSet.h"
+#include "TDSHealthSet.h"
+#include "TDSGameplayTags.h"
+
+struct FTDSDamageStatics
+{
+	DECLARE_ATTRIBUTE_CAPTUREDEF(Armor);
+	DECLARE_ATTRIBUTE_CAPTUREDEF(DamageResistance);
+	DECLARE_ATTRIBUTE_CAPTUREDEF(CritChance);
+	DECLARE_ATTRIBUTE_CAPTUREDEF(CritMultiplier);
+
+	FTDSDamageStatics()
+	{
+		DEFINE_ATTRIBUTE_CAPTUREDEF(UTDSCombatSet, Armor, Target, false);
+		DEFINE_ATTRIBUTE_CAPTUREDEF(UTDSCombatSet, DamageResistance, Target, false);
+		DEFINE_ATTRIBUTE_CAPTUREDEF(UTDSCombatSet, CritChance, Source, true);
+		DEFINE_ATTRIBUTE_CAPTUREDEF(UTDSCombatSet, CritMultiplier, Source, true);
+	}
+};
+
+static const FTDSDamageStatics& DamageStatics()
+{
+	static FTDSDamageStatics Statics;
+	return Statics;
+}
+
+void FTDSDamageTargets::Reset(int32 ExpectedNum)
+{
+	Armor.Reset(ExpectedNum);
+	DamageResistance.Reset(ExpectedNum);
+	Distance.Reset(ExpectedNum);
+}
+
+void FTDSDamageTargets::Add(float InArmor, float InDamageResistance, float InDistance)
+{
+	Armor.Add(InArmor);
+	DamageResistance.Add(InDamageResistance);
+	Distance.Add(InDistance);
+}
+
+UTDSDamageExecution::UTDSDamageExecution()
+{
+	RelevantAttributesToCapture.Add(DamageStatics().ArmorDef);
+	RelevantAttributesToCapture.Add(DamageStatics().DamageResistanceDef);
+	RelevantAttributesToCapture.Add(DamageStatics().CritChanceDef);
+	RelevantAttributesToCapture.Add(DamageStatics().CritMultiplierDef);
+}
+
+void UTDSDamageExecution::Execute_Implementation(const FGameplayEffectCustomExecutionParameters& ExecutionParams, FGameplayEffectCustomExecutionOutput& OutExecutionOutput) const
+{
+	const FGameplayEffectSpec& Spec = ExecutionParams.GetOwningSpec();
+
+	FTDSDamageShot Shot;
+	Shot.BaseDamage = Spec.GetSetByCallerMagnitude(TDSGameplayTags::Damage_SetByCaller, false, 0.0f);
+
+	float Damage = Shot.BaseDamage;
+	if(!Spec.GetDynamicAssetTags().HasTagExact(TDSGameplayTags::Damage_Resolved))
+	{
+		FAggregatorEvaluateParameters EvaluationParameters;
+		EvaluationParameters.SourceTags = Spec.CapturedSourceTags.GetAggregatedTags();
+		EvaluationParameters.TargetTags = Spec.CapturedTargetTags.GetAggregatedTags();
+
+		float Armor = 0.0f;
+		float DamageResistance = 0.0f;
+		ExecutionParams.AttemptCalculateCapturedAttributeMagnitude(DamageStatics().ArmorDef, EvaluationParameters, Armor);
+		ExecutionParams.AttemptCalculateCapturedAttributeMagnitude(DamageStatics().DamageResistanceDef, EvaluationParameters, DamageResistance);
+		ExecutionParams.AttemptCalculateCapturedAttributeMagnitude(DamageStatics().CritChanceDef, EvaluationParameters, Shot.CritChance);
+		ExecutionParams.AttemptCalculateCapturedAttributeMagnitude(DamageStatics().CritMultiplierDef, EvaluationParameters, Shot.CritMultiplier);
+
+		// Falloff is measured from the trace start to the impact when there is a hit, else between the two actors
+		float Distance = 0.0f;
+		const FGameplayEffectContextHandle& EffectContext = Spec.GetContext();
+		if(const FHitResult* HitResult = EffectContext.GetHitResult())
+		{
+			Distance = FVector::Dist(HitResult->TraceStart, HitResult->ImpactPoint);
+		}
+		else
+		{
+			const UAbilitySystemComponent* SourceASC = ExecutionParams.GetSourceAbilitySystemComponent();
+			const UAbilitySystemComponent* TargetASC = ExecutionParams.GetTargetAbilitySystemComponent();
+			const AActor* SourceActor = SourceASC ? SourceASC->GetAvatarActor() : nullptr;
+			const AActor* TargetActor = TargetASC ? TargetASC->GetAvatarActor() : nullptr;
+			if(SourceActor && TargetActor)
+			{
+				Distance = FVector::Dist(EffectContext.HasOrigin() ? EffectContext.GetOrigin() : SourceActor->GetActorLocation(), TargetActor->GetActorLocation());
+			}
+		}
+
+		Damage = EvaluateSingle(Shot, Armor, DamageResistance, Distance, FMath::FRand() < Shot.CritChance);
+	}
+
+	if(Damage > 0.0f)
+	{
+		OutExecutionOutput.AddOutputModifier(FGameplayModifierEvaluatedData(UTDSHealthSet::GetInDamageAttribute(), EGameplayModOp::Additive, Damage));
+	}
+}
+
+float UTDSDamageExecution::EvaluateSingle(const FTDSDamageShot& Shot, float Armor, float DamageResistance, float Distance, bool bCrit) const
+{
+	return EvaluateWithCritFactor(Shot.BaseDamage, Armor, DamageResistance, Distance, bCrit ? Shot.CritMultiplier : 1.0f);
+}
+
+float UTDSDamageExecution::EvaluateWithCritFactor(float BaseDamage, float Armor, float DamageResistance, float Distance, float CritFactor) const
+{
+	const float FalloffRange = FMath::Max(FalloffEnd - FalloffStart, UE_KINDA_SMALL_NUMBER);
+	const float FalloffAlpha = FMath::Clamp((Distance - FalloffStart) / FalloffRange, 0.0f, 1.0f);
+	const float Falloff = 1.0f + FalloffAlpha * (FalloffMinMultiplier - 1.0f);
+
+	const float ArmorFactor = ArmorConstant / (ArmorConstant + FMath::Max(Armor, 0.0f));
+	const float ResistanceFactor = 1.0f - FMath::Clamp(DamageResistance, 0.0f, 1.0f);
+
+	return BaseDamage * Falloff * CritFactor * ArmorFactor * ResistanceFactor;
+}
+
+void UTDSDamageExecution::EvaluateBatch(const FTDSDamageShot& Shot, const FTDSDamageTargets& Targets, TArray<float>& OutDamage) const
+{
+	const int32 NumTargets = Targets.Num();
+	OutDamage.SetNumUninitialized(NumTargets);
+	if(NumTargets == 0) return;
+
+	// Crit rolls stay scalar, everything after them runs four targets at a time
+	TArray<float, TInlineAllocator<32>> Crits;
+	Crits.SetNumUninitialized(NumTargets);
+	const FRandomStream CritStream(Shot.Seed);
+	for(int32 Index = 0; Index < NumTargets; ++Index)
+	{
+		Crits[Index] = CritStream.GetFraction() < Shot.CritChance ? Shot.CritMultiplier : 1.0f;
+	}
+
+	const float FalloffRange = FMath::Max(FalloffEnd - FalloffStart, UE_KINDA_SMALL_NUMBER);
+
+	const VectorRegister4Float VZero = VectorZeroFloat();
+	const VectorRegister4Float VOne = VectorOneFloat();
+	const VectorRegister4Float VBaseDamage = VectorSetFloat1(Shot.BaseDamage);
+	const VectorRegister4Float VFalloffStart = VectorSetFloat1(FalloffStart);
+	const VectorRegister4Float VInvFalloffRange = VectorSetFloat1(1.0f / FalloffRange);
+	const VectorRegister4Float VFalloffDelta = VectorSetFloat1(FalloffMinMultiplier - 1.0f);
+	const VectorRegister4Float VArmorConstant = VectorSetFloat1(ArmorConstant);
+
+	int32 Index = 0;
+	for(; Index + 4 <= NumTargets; Index += 4)
+	{
+		VectorRegister4Float VFalloffAlpha = VectorMultiply(VectorSubtract(VectorLoad(&Targets.Distance[Index]), VFalloffStart), VInvFalloffRange);
+		VFalloffAlpha = VectorMin(VectorMax(VFalloffAlpha, VZero), VOne);
+		const VectorRegister4Float VFalloff = VectorMultiplyAdd(VFalloffAlpha, VFalloffDelta, VOne);
+
+		const VectorRegister4Float VArmor = VectorMax(VectorLoad(&Targets.Armor[Index]), VZero);
+		const VectorRegister4Float VArmorFactor = VectorDivide(VArmorConstant, VectorAdd(VArmorConstant, VArmor));
+
+		const VectorRegister4Float VResistance = VectorMin(VectorMax(VectorLoad(&Targets.DamageResistance[Index]), VZero), VOne);
+		const VectorRegister4Float VResistanceFactor = VectorSubtract(VOne, VResistance);
+
+		VectorRegister4Float VDamage = VectorMultiply(VBaseDamage, VFalloff);
+		VDamage = VectorMultiply(VDamage, VectorLoad(&Crits[Index]));
+		VDamage = VectorMultiply(VDamage, VArmorFactor);
+		VDamage = VectorMultiply(VDamage, VResistanceFactor);
+		VectorStore(VDamage, &OutDamage[Index]);
+	}
+
+	for(; Index < NumTargets; ++Index)
+	{
+		OutDamage[Index] = EvaluateWithCritFactor(Shot.BaseDamage, Targets.Armor[Index], Targets.DamageResistance[Index], Targets.Distance[Index], Crits[Index]);
+	}
+}
@@ -0,0 +1,73 @@
+// Copyright, The Lounge
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameplayEffectExecutionCalculation.h"
+#include "TDSDamageExecution.generated.h"
+
+/**
+ * Source side inputs of one shot, shared by every target it hits.
+ */
+struct FTDSDamageShot
+{
+	float BaseDamage{0.0f};
+	float CritChance{0.0f};
+	float CritMultiplier{1.0f};
+	int32 Seed{0};
+};
+
+/**
+ * Target stats packed as one array per stat, so a shot is evaluated against many targets in one pass.
+ */
+struct TDS_API FTDSDamageTargets
+{
+	TArray<float> Armor;
+	TArray<float> DamageResistance;
+	TArray<float> Distance;
+
+	void Reset(int32 ExpectedNum);
+	void Add(float InArmor, float InDamageResistance, float InDistance);
+	int32 Num() const { return Armor.Num(); }
+};
+
+/**
+ * Turns Damage.SetByCaller into InDamage, applying distance falloff, crits, armor and resistance.
+ */
+UCLASS()
+class TDS_API UTDSDamageExecution : public UGameplayEffectExecutionCalculation
+{
+	GENERATED_BODY()
+
+public:
+	UTDSDamageExecution();
+
+	virtual void Execute_Implementation(const FGameplayEffectCustomExecutionParameters& ExecutionParams, FGameplayEffectCustomExecutionOutput& OutExecutionOutput) const override;
+
+	/**
+	 * Damage of one shot against every packed target. Apply the results with the Damage.Resolved tag
+	 * so Execute passes them through unchanged.
+	 */
+	void EvaluateBatch(const FTDSDamageShot& Shot, const FTDSDamageTargets& Targets, TArray<float>& OutDamage) const;
+
+	float EvaluateSingle(const FTDSDamageShot& Shot, float Armor, float DamageResistance, float Distance, bool bCrit) const;
+
+protected:
+	/** EvaluateSingle with the crit already rolled into a factor, 1 for no crit. */
+	float EvaluateWithCritFactor(float BaseDamage, float Armor, float DamageResistance, float Distance, float CritFactor) const;
+
+	/** Distance at which damage starts to fall off. */
+	UPROPERTY(EditDefaultsOnly, Category = "Falloff", meta = (ClampMin = 0.0f))
+	float FalloffStart{1500.0f};
+
+	/** Distance at which damage reaches FalloffMinMultiplier. */
+	UPROPERTY(EditDefaultsOnly, Category = "Falloff", meta = (ClampMin = 0.0f))
+	float FalloffEnd{4000.0f};
+
+	UPROPERTY(EditDefaultsOnly, Category = "Falloff", meta = (ClampMin = 0.0f, ClampMax = 1.0f))
+	float FalloffMinMultiplier{0.5f};
+
+	/** Armor equal to this value halves incoming damage. */
+	UPROPERTY(EditDefaultsOnly, Category = "Armor", meta = (ClampMin = 1.0f))
+	float ArmorConstant{100.0f};
+};
@@ -0,0 +1,330 @@
+// Copyright, The Lounge
+
+
+#include "TDSGASSnapshot.h"
+#include "AbilitySystemComponent.h"
+#include "Abilities/GameplayAbility.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "UObject/SoftObjectPath.h"
+
+DEFINE_LOG_CATEGORY(LogTDSGASSnapshot);
+
+namespace TDSGASSnapshot
+{
+	static constexpr uint32 Magic = 0x47534454; // "TDSG"
+	static constexpr uint16 Version = 1;
+
+	class FStringTable
+	{
+	public:
+		uint16 Add(const FString& String)
+		{
+			if(const uint16* Index = Indices.Find(String))
+			{
+				return *Index;
+			}
+			check(Strings.Num() < MAX_uint16);
+			const uint16 Index = static_cast<uint16>(Strings.Add(String));
+			Indices.Add(String, Index);
+			return Index;
+		}
+
+		TArray<FString> Strings;
+
+	private:
+		TMap<FString, uint16> Indices;
+	};
+
+	template<typename ClassType>
+	static UClass* ResolveClass(const TArray<FString>& Strings, uint16 Index)
+	{
+		return Strings.IsValidIndex(Index) ? FSoftClassPath(Strings[Index]).TryLoadClass<ClassType>() : nullptr;
+	}
+
+	static void RestoreAttributes(UAbilitySystemComponent& AbilitySystemComponent, const TArray<TPair<FGameplayAttribute, float>>& Attributes)
+	{
+		// A second pass settles attributes clamped by one that was restored after them, Health by MaxHealth
+		for(int32 Pass = 0; Pass < 2; ++Pass)
+		{
+			for(const TPair<FGameplayAttribute, float>& Attribute : Attributes)
+			{
+				if(AbilitySystemComponent.GetNumericAttributeBase(Attribute.Key) != Attribute.Value)
+				{
+					AbilitySystemComponent.SetNumericAttributeBase(Attribute.Key, Attribute.Value);
+				}
+			}
+		}
+	}
+}
+
+bool FTDSGASSnapshot::Capture(const UAbilitySystemComponent& AbilitySystemComponent, TArray<uint8>& OutData)
+{
+	const UWorld* World = AbilitySystemComponent.GetWorld();
+	if(!World || !AbilitySystemComponent.IsOwnerActorAuthoritative()) return false;
+
+	TDSGASSnapshot::FStringTable StringTable;
+	TArray<uint8> Body;
+	FMemoryWriter BodyWriter(Body);
+
+	// Attributes
+	TArray<FGameplayAttribute> Attributes;
+	for(const UAttributeSet* AttributeSet : AbilitySystemComponent.GetSpawnedAttributes())
+	{
+		if(AttributeSet)
+		{
+			UAttributeSet::GetAttributesFromSetClass(AttributeSet->GetClass(), Attributes);
+		}
+	}
+
+	uint16 NumAttributes = static_cast<uint16>(Attributes.Num());
+	BodyWriter << NumAttributes;
+	for(const FGameplayAttribute& Attribute : Attributes)
+	{
+		uint16 ClassIndex = StringTable.Add(Attribute.GetAttributeSetClass()->GetPathName());
+		uint16 NameIndex = StringTable.Add(Attribute.GetName());
+		float BaseValue = AbilitySystemComponent.GetNumericAttributeBase(Attribute);
+		BodyWriter << ClassIndex << NameIndex << BaseValue;
+	}
+
+	// Abilities
+	TArray<const FGameplayAbilitySpec*, TInlineAllocator<16>> AbilitySpecs;
+	for(const FGameplayAbilitySpec& AbilitySpec : AbilitySystemComponent.GetActivatableAbilities())
+	{
+		if(AbilitySpec.Ability && !AbilitySpec.PendingRemove)
+		{
+			AbilitySpecs.Add(&AbilitySpec);
+		}
+	}
+
+	uint16 NumAbilities = static_cast<uint16>(AbilitySpecs.Num());
+	BodyWriter << NumAbilities;
+	for(const FGameplayAbilitySpec* AbilitySpec : AbilitySpecs)
+	{
+		uint16 ClassIndex = StringTable.Add(AbilitySpec->Ability->GetClass()->GetPathName());
+		int32 Level = AbilitySpec->Level;
+		int32 InputID = AbilitySpec->InputID;
+		BodyWriter << ClassIndex << Level << InputID;
+	}
+
+	// Effects
+	const float WorldTime = World->GetTimeSeconds();
+	TArray<const FActiveGameplayEffect*, TInlineAllocator<16>> ActiveEffects;
+	for(FActiveGameplayEffectsContainer::ConstIterator It = AbilitySystemComponent.GetActiveGameplayEffects().CreateConstIterator(); It; ++It)
+	{
+		// Instant effects never become active, their result is already in the base values
+		if(!It->IsPendingRemove && It->Spec.Def && It->Spec.GetDuration() != FGameplayEffectConstants::INSTANT_APPLICATION)
+		{
+			ActiveEffects.Add(&*It);
+		}
+	}
+
+	// Nothing granted yet, restoring this would stand in for the default abilities and effects
+	if(AbilitySpecs.Num() == 0 && ActiveEffects.Num() == 0) return false;
+
+	uint16 NumEffects = static_cast<uint16>(ActiveEffects.Num());
+	BodyWriter << NumEffects;
+	for(const FActiveGameplayEffect* ActiveEffect : ActiveEffects)
+	{
+		const FGameplayEffectSpec& Spec = ActiveEffect->Spec;
+
+		uint16 ClassIndex = StringTable.Add(Spec.Def->GetClass()->GetPathName());
+		float Level = Spec.GetLevel();
+		float TimeRemaining = Spec.GetDuration() == FGameplayEffectConstants::INFINITE_DURATION ? FGameplayEffectConstants::INFINITE_DURATION : FMath::Max(ActiveEffect->GetTimeRemaining(WorldTime), 0.0f);
+		int32 StackCount = Spec.GetStackCount();
+		BodyWriter << ClassIndex << Level << TimeRemaining << StackCount;
+
+		uint8 NumSetByCaller = static_cast<uint8>(FMath::Min(Spec.SetByCallerTagMagnitudes.Num(), static_cast<int32>(MAX_uint8)));
+		BodyWriter << NumSetByCaller;
+		int32 Written = 0;
+		for(const TPair<FGameplayTag, float>& SetByCaller : Spec.SetByCallerTagMagnitudes)
+		{
+			if(Written++ == NumSetByCaller) break;
+
+			uint16 TagIndex = StringTable.Add(SetByCaller.Key.ToString());
+			float Magnitude = SetByCaller.Value;
+			BodyWriter << TagIndex << Magnitude;
+		}
+	}
+
+	OutData.Reset();
+	FMemoryWriter Writer(OutData);
+
+	uint32 Magic = TDSGASSnapshot::Magic;
+	uint16 Version = TDSGASSnapshot::Version;
+	uint16 NumStrings = static_cast<uint16>(StringTable.Strings.Num());
+	Writer << Magic << Version << NumStrings;
+	for(FString& String : StringTable.Strings)
+	{
+		Writer << String;
+	}
+	Writer.Serialize(Body.GetData(), Body.Num());
+	return true;
+}
+
+bool FTDSGASSnapshot::Restore(UAbilitySystemComponent& AbilitySystemComponent, const TArray<uint8>& Data, TArray<FGameplayAbilitySpecHandle>* OutAbilityHandles)
+{
+	if(!AbilitySystemComponent.IsOwnerActorAuthoritative()) return false;
+
+	FMemoryReader Reader(Data);
+
+	uint32 Magic = 0;
+	uint16 Version = 0;
+	Reader << Magic << Version;
+	if(Reader.IsError() || Magic != TDSGASSnapshot::Magic || Version > TDSGASSnapshot::Version)
+	{
+		UE_LOG(LogTDSGASSnapshot, Error, TEXT("Not a GAS snapshot, or written by a newer version (%d)"), Version);
+		return false;
+	}
+
+	uint16 NumStrings = 0;
+	Reader << NumStrings;
+	TArray<FString> Strings;
+	Strings.SetNum(NumStrings);
+	for(FString& String : Strings)
+	{
+		Reader << String;
+	}
+
+	// Parse everything before touching the ASC, a truncated snapshot leaves it as it was
+	TArray<TPair<FGameplayAttribute, float>> Attributes;
+	uint16 NumAttributes = 0;
+	Reader << NumAttributes;
+	for(int32 Index = 0; Index < NumAttributes; ++Index)
+	{
+		uint16 ClassIndex = 0;
+		uint16 NameIndex = 0;
+		float BaseValue = 0.0f;
+		Reader << ClassIndex << NameIndex << BaseValue;
+
+		UClass* AttributeSetClass = TDSGASSnapshot::ResolveClass<UAttributeSet>(Strings, ClassIndex);
+		FProperty* Property = AttributeSetClass && Strings.IsValidIndex(NameIndex) ? FindFProperty<FProperty>(AttributeSetClass, *Strings[NameIndex]) : nullptr;
+		if(Property && AbilitySystemComponent.HasAttributeSetForAttribute(FGameplayAttribute(Property)))
+		{
+			Attributes.Emplace(FGameplayAttribute(Property), BaseValue);
+		}
+	}
+
+	struct FAbilityEntry
+	{
+		UClass* Class;
+		int32 Level;
+		int32 InputID;
+	};
+	TArray<FAbilityEntry, TInlineAllocator<16>> Abilities;
+	uint16 NumAbilities = 0;
+	Reader << NumAbilities;
+	for(int32 Index = 0; Index < NumAbilities; ++Index)
+	{
+		uint16 ClassIndex = 0;
+		int32 Level = 1;
+		int32 InputID = INDEX_NONE;
+		Reader << ClassIndex << Level << InputID;
+
+		if(UClass* AbilityClass = TDSGASSnapshot::ResolveClass<UGameplayAbility>(Strings, ClassIndex))
+		{
+			Abilities.Add({AbilityClass, Level, InputID});
+		}
+	}
+
+	struct FEffectEntry
+	{
+		UClass* Class;
+		float Level;
+		float TimeRemaining;
+		int32 StackCount;
+		TArray<TPair<FGameplayTag, float>, TInlineAllocator<2>> SetByCallers;
+	};
+	TArray<FEffectEntry, TInlineAllocator<16>> Effects;
+	uint16 NumEffects = 0;
+	Reader << NumEffects;
+	for(int32 Index = 0; Index < NumEffects; ++Index)
+	{
+		FEffectEntry Entry;
+		uint16 ClassIndex = 0;
+		uint8 NumSetByCaller = 0;
+		Reader << ClassIndex << Entry.Level << Entry.TimeRemaining << Entry.StackCount << NumSetByCaller;
+		for(int32 SetByCallerIndex = 0; SetByCallerIndex < NumSetByCaller; ++SetByCallerIndex)
+		{
+			uint16 TagIndex = 0;
+			float Magnitude = 0.0f;
+			Reader << TagIndex << Magnitude;
+
+			const FGameplayTag Tag = Strings.IsValidIndex(TagIndex) ? FGameplayTag::RequestGameplayTag(FName(*Strings[TagIndex]), false) : FGameplayTag();
+			if(Tag.IsValid())
+			{
+				Entry.SetByCallers.Emplace(Tag, Magnitude);
+			}
+		}
+
+		Entry.Class = TDSGASSnapshot::ResolveClass<UGameplayEffect>(Strings, ClassIndex);
+		if(Entry.Class)
+		{
+			Effects.Add(MoveTemp(Entry));
+		}
+	}
+
+	if(Reader.IsError())
+	{
+		UE_LOG(LogTDSGASSnapshot, Error, TEXT("GAS snapshot is truncated, nothing restored"));
+		return false;
+	}
+
+	// Replace the current state
+	for(const FActiveGameplayEffectHandle& Handle : AbilitySystemComponent.GetActiveEffects(FGameplayEffectQuery()))
+	{
+		AbilitySystemComponent.RemoveActiveGameplayEffect(Handle);
+	}
+	if(OutAbilityHandles)
+	{
+		OutAbilityHandles->Reset(Abilities.Num());
+	}
+
+	UObject* SourceObject = AbilitySystemComponent.GetAvatarActor();
+	for(const FAbilityEntry& Ability : Abilities)
+	{
+		FGameplayAbilitySpecHandle Handle;
+		if(FGameplayAbilitySpec* ExistingSpec = AbilitySystemComponent.FindAbilitySpecFromClass(Ability.Class))
+		{
+			ExistingSpec->Level = Ability.Level;
+			ExistingSpec->InputID = Ability.InputID;
+			AbilitySystemComponent.MarkAbilitySpecDirty(*ExistingSpec);
+			Handle = ExistingSpec->Handle;
+		}
+		else
+		{
+			Handle = AbilitySystemComponent.GiveAbility(FGameplayAbilitySpec(Ability.Class, Ability.Level, Ability.InputID, SourceObject));
+		}
+
+		if(OutAbilityHandles)
+		{
+			OutAbilityHandles->Add(Handle);
+		}
+	}
+
+	FGameplayEffectContextHandle EffectContext = AbilitySystemComponent.MakeEffectContext();
+	EffectContext.AddSourceObject(SourceObject);
+	for(const FEffectEntry& Effect : Effects)
+	{
+		FGameplayEffectSpecHandle SpecHandle = AbilitySystemComponent.MakeOutgoingSpec(Effect.Class, Effect.Level, EffectContext);
+		if(!SpecHandle.IsValid()) continue;
+
+		FGameplayEffectSpec& Spec = *SpecHandle.Data.Get();
+		for(const TPair<FGameplayTag, float>& SetByCaller : Effect.SetByCallers)
+		{
+			Spec.SetSetByCallerMagnitude(SetByCaller.Key, SetByCaller.Value);
+		}
+		Spec.SetStackCount(Effect.StackCount);
+
+		// The time left becomes the new duration, locked so the spec does not recalculate it
+		if(Effect.TimeRemaining != FGameplayEffectConstants::INFINITE_DURATION)
+		{
+			Spec.SetDuration(FMath::Max(Effect.TimeRemaining, UE_KINDA_SMALL_NUMBER), true);
+		}
+		AbilitySystemComponent.ApplyGameplayEffectSpecToSelf(Spec);
+	}
+
+	// Base values last so modifiers from restored effects are already in place for clamping
+	TDSGASSnapshot::RestoreAttributes(AbilitySystemComponent, Attributes);
+	return true;
+}
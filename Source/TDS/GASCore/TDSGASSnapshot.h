@@ -0,0 +1,32 @@
+// Copyright, The Lounge
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameplayAbilitySpec.h"
+
+class UAbilitySystemComponent;
+
+DECLARE_LOG_CATEGORY_EXTERN(LogTDSGASSnapshot, Log, All);
+
+/**
+ * Compact versioned binary snapshot of an ASC: attribute base values, granted ability specs and
+ * active duration/infinite effects with their remaining time, stacks and SetByCaller magnitudes.
+ *
+ * Classes, attributes and tags are written once into a string table and referenced by index,
+ * so a snapshot stays valid across maps, builds with the same content and server instances.
+ */
+class TDS_API FTDSGASSnapshot
+{
+public:
+	/** Server only, false when the ASC is not authoritative or has neither abilities nor active effects. */
+	static bool Capture(const UAbilitySystemComponent& AbilitySystemComponent, TArray<uint8>& OutData);
+
+	/**
+	 * Replaces the ASC's effects with the snapshot's and grants its abilities in one pass on the server.
+	 * Abilities the ASC already has keep their spec with the snapshot's level and input, abilities that are
+	 * not part of the snapshot are left alone. OutAbilityHandles receives the spec of every restored ability.
+	 * Everything changes within the same frame, so clients receive it as one replication update.
+	 */
+	static bool Restore(UAbilitySystemComponent& AbilitySystemComponent, const TArray<uint8>& Data, TArray<FGameplayAbilitySpecHandle>* OutAbilityHandles = nullptr);
+};
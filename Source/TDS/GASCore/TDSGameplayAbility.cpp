@@ -2,4 +2,26 @@
 
 
 #include "TDSGameplayAbility.h"
+#include "../Core/TDSTelemetrySubsystem.h"
 
+void UTDSGameplayAbility::ActivateAbility(const FGameplayAbilitySpecHandle Handle, const FGameplayAbilityActorInfo* ActorInfo, const FGameplayAbilityActivationInfo ActivationInfo, const FGameplayEventData* TriggerEventData)
+{
+	// Server side only, predicted activations would be counted twice
+	if(ActorInfo && ActorInfo->IsNetAuthority())
+	{
+		const AActor* Avatar = ActorInfo->AvatarActor.Get();
+
+		FTDSTelemetryEvent Event;
+		Event.Type = ETDSTelemetryEvent::AbilityActivated;
+		Event.Instigator = Avatar ? Avatar->GetFName() : NAME_None;
+		Event.Subject = GetClass()->GetFName();
+		Event.Value = static_cast<float>(GetAbilityLevel(Handle, ActorInfo));
+		if(Avatar)
+		{
+			Event.Location = FVector3f(Avatar->GetActorLocation());
+		}
+		UTDSTelemetrySubsystem::Record(Avatar, Event);
+	}
+
+	Super::ActivateAbility(Handle, ActorInfo, ActivationInfo, TriggerEventData);
+}
@@ -0,0 +1,10 @@
+// Copyright, The Lounge
+
+
+#include "TDSGameplayTags.h"
+
+namespace TDSGameplayTags
+{
+	UE_DEFINE_GAMEPLAY_TAG(Damage_SetByCaller, "Damage.SetByCaller");
+	UE_DEFINE_GAMEPLAY_TAG(Damage_Resolved, "Damage.Resolved");
+}
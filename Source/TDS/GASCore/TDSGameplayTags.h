@@ -0,0 +1,17 @@
+// Copyright, The Lounge
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "NativeGameplayTags.h"
+
+/**
+ * Tags referenced from native code. They are also listed in DefaultGameplayTags.ini for the editor.
+ */
+namespace TDSGameplayTags
+{
+	TDS_API UE_DECLARE_GAMEPLAY_TAG_EXTERN(Damage_SetByCaller);
+
+	/** On a damage spec whose SetByCaller magnitude is already final, see UTDSDamageExecution::EvaluateBatch. */
+	TDS_API UE_DECLARE_GAMEPLAY_TAG_EXTERN(Damage_Resolved);
+}
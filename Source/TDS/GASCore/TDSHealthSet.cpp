@@ -2,76 +2,34 @@
 
 
 #include "TDSHealthSet.h"
-#include "Net/UnrealNetwork.h"
 #include "GameplayEffectExtension.h"
+#include "GameFramework/Pawn.h"
+#include "../Core/TDSTelemetrySubsystem.h"
 
 UTDSHealthSet::UTDSHealthSet() : Health(40.0f), MaxHealth(60.0f), Shield(0.0f), MaxShield(0.0f), ShieldRegen(0.0f), ShieldRegenDelay(1.0f)
 {
 	
 }
 
-void UTDSHealthSet::ClampAttributeOnChange(const FGameplayAttribute& Attribute, float& NewValue) const
+void UTDSHealthSet::DeclareAttributes(FTDSAttributeTable& Table) const
 {
-	if(Attribute == GetHealthAttribute())
-	{
-		NewValue = FMath::Clamp(NewValue, 0.0f, GetMaxHealth());
-	}
-	else if(Attribute == GetShieldAttribute())
-	{
-		NewValue = FMath::Clamp(NewValue, 0.0f, GetMaxShield());
-	}
-}
-
-void UTDSHealthSet::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
-{
-	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
-
-	DOREPLIFETIME_CONDITION_NOTIFY(UTDSHealthSet, Health, COND_None, REPNOTIFY_Always);
-	DOREPLIFETIME_CONDITION_NOTIFY(UTDSHealthSet, MaxHealth, COND_None, REPNOTIFY_Always);
-	DOREPLIFETIME_CONDITION_NOTIFY(UTDSHealthSet, Shield, COND_None, REPNOTIFY_Always);
-	DOREPLIFETIME_CONDITION_NOTIFY(UTDSHealthSet, MaxShield, COND_None, REPNOTIFY_Always);
-	DOREPLIFETIME_CONDITION_NOTIFY(UTDSHealthSet, ShieldRegen, COND_None, REPNOTIFY_Always);
-	DOREPLIFETIME_CONDITION_NOTIFY(UTDSHealthSet, ShieldRegenDelay, COND_None, REPNOTIFY_Always);
-	DOREPLIFETIME_CONDITION_NOTIFY(UTDSHealthSet, InDamage, COND_None, REPNOTIFY_Always);
-}
-
-#pragma region Replication, uses GetLifetimeReplicatedProps
-
-void UTDSHealthSet::OnRep_Health(const FGameplayAttributeData& OldHealth)
-{
-	GAMEPLAYATTRIBUTE_REPNOTIFY(UTDSHealthSet, Health, OldHealth);
-}
-
-void UTDSHealthSet::OnRep_MaxHealth(const FGameplayAttributeData& OldMaxHealth)
-{
-	GAMEPLAYATTRIBUTE_REPNOTIFY(UTDSHealthSet, MaxHealth, OldMaxHealth);
-}
-
-void UTDSHealthSet::OnRep_Shield(const FGameplayAttributeData& OldShield)
-{
-	GAMEPLAYATTRIBUTE_REPNOTIFY(UTDSHealthSet, Shield, OldShield);
-}
-
-void UTDSHealthSet::OnRep_MaxShield(const FGameplayAttributeData& OldMaxShield)
-{
-	GAMEPLAYATTRIBUTE_REPNOTIFY(UTDSHealthSet, MaxShield, OldMaxShield);
-}
-
-void UTDSHealthSet::OnRep_ShieldRegen(const FGameplayAttributeData& OldShieldRegen)
-{
-	GAMEPLAYATTRIBUTE_REPNOTIFY(UTDSHealthSet, ShieldRegen, OldShieldRegen);
+	Table.Declare(GetHealthAttribute()).Clamp(0.0f, GetMaxHealthAttribute());
+	Table.Declare(GetMaxHealthAttribute());
+	Table.Declare(GetShieldAttribute()).Clamp(0.0f, GetMaxShieldAttribute());
+	Table.Declare(GetMaxShieldAttribute());
+	Table.Declare(GetShieldRegenAttribute()).Replicate(COND_OwnerOnly);
+	Table.Declare(GetShieldRegenDelayAttribute()).Replicate(COND_OwnerOnly);
+	Table.Declare(GetInDamageAttribute());
 }
 
-void UTDSHealthSet::OnRep_ShieldRegenDelay(const FGameplayAttributeData& OldShieldRegenDelay)
-{
-	GAMEPLAYATTRIBUTE_REPNOTIFY(UTDSHealthSet, ShieldRegenDelay, OldShieldRegenDelay);
-}
-
-void UTDSHealthSet::OnRep_InDamage(const FGameplayAttributeData& OldInDamage)
-{
-	GAMEPLAYATTRIBUTE_REPNOTIFY(UTDSHealthSet, InDamage, OldInDamage);
-}
+#pragma region Replication, registered from the attribute table
 
+ATTRIBUTE_REPNOTIFY(UTDSHealthSet, Health)
+ATTRIBUTE_REPNOTIFY(UTDSHealthSet, MaxHealth)
+ATTRIBUTE_REPNOTIFY(UTDSHealthSet, Shield)
+ATTRIBUTE_REPNOTIFY(UTDSHealthSet, MaxShield)
+ATTRIBUTE_REPNOTIFY(UTDSHealthSet, ShieldRegen)
+ATTRIBUTE_REPNOTIFY(UTDSHealthSet, ShieldRegenDelay)
 
 #pragma endregion	
 
@@ -81,25 +39,66 @@ void UTDSHealthSet::PostGameplayEffectExecute(const FGameplayEffectModCallbackDa
 
 	if(Data.EvaluatedData.Attribute == GetInDamageAttribute())
 	{
-		float InDamageDone = GetInDamage();
+		const float InDamageDone = GetInDamage();
 		SetInDamage(0.0f);
 		if(InDamageDone > 0.0f)
 		{
-			if(GetShield() > 0.0f)
+			float NewShield = GetShield();
+			float NewHealth = GetHealth();
+			SplitDamage(InDamageDone, NewShield, NewHealth);
+
+			if(NewShield != GetShield())
 			{
-				float NewShield = GetShield();
-				const float ShielfDiff = FMath::Min(NewShield, InDamageDone);
-				InDamageDone -= ShielfDiff;
-				NewShield -= ShielfDiff;
 				SetShield(NewShield);
 			}
-
-			if(InDamageDone > 0.0f)
+			const bool bKilled = GetHealth() > 0.0f && NewHealth <= 0.0f;
+			if(NewHealth != GetHealth())
 			{
-				float NewHealth = GetHealth();
-				const float HealthDiff = FMath::Min(NewHealth, InDamageDone);
-				SetHealth(NewHealth - HealthDiff);
+				SetHealth(NewHealth);
 			}
+
+			RecordDamageTelemetry(Data, InDamageDone, bKilled);
 		}
 	}
 }
+
+void UTDSHealthSet::RecordDamageTelemetry(const FGameplayEffectModCallbackData& Data, float Damage, bool bKilled) const
+{
+	const FGameplayEffectContextHandle& EffectContext = Data.EffectSpec.GetContext();
+	const AActor* TargetActor = Data.Target.GetAvatarActor();
+
+	FTDSTelemetryEvent Event;
+	Event.Type = ETDSTelemetryEvent::Damage;
+	Event.Value = Damage;
+	Event.Instigator = EffectContext.GetOriginalInstigator() ? EffectContext.GetOriginalInstigator()->GetFName() : NAME_None;
+	Event.Target = TargetActor ? TargetActor->GetFName() : NAME_None;
+	Event.Subject = Data.EffectSpec.Def ? Data.EffectSpec.Def->GetClass()->GetFName() : NAME_None;
+	if(const FHitResult* HitResult = EffectContext.GetHitResult())
+	{
+		Event.Location = FVector3f(HitResult->ImpactPoint);
+	}
+	else if(TargetActor)
+	{
+		Event.Location = FVector3f(TargetActor->GetActorLocation());
+	}
+	UTDSTelemetrySubsystem::Record(GetOwningActor(), Event);
+
+	if(bKilled)
+	{
+		// Anything with health that is not a pawn is a destructible
+		Event.Type = Cast<APawn>(TargetActor) ? ETDSTelemetryEvent::Kill : ETDSTelemetryEvent::DestructibleDeath;
+		UTDSTelemetrySubsystem::Record(GetOwningActor(), Event);
+	}
+}
+
+void UTDSHealthSet::SplitDamage(float Damage, float& InOutShield, float& InOutHealth)
+{
+	if(Damage <= 0.0f) return;
+
+	const float ShieldDiff = FMath::Min(FMath::Max(InOutShield, 0.0f), Damage);
+	InOutShield -= ShieldDiff;
+	Damage -= ShieldDiff;
+
+	const float HealthDiff = FMath::Min(FMath::Max(InOutHealth, 0.0f), Damage);
+	InOutHealth -= HealthDiff;
+}
@@ -26,31 +26,37 @@ public:
 	FGameplayAttributeData MaxHealth;
 	ATTRIBUTE_ACCESSORS(UTDSHealthSet, MaxHealth);
 
-	UPROPERTY(BlueprintReadOnly, ReplicatedUsing = OnRep_MaxHealth, Category = "Attributes", meta = (AllowPrivateAccess = true))
+	UPROPERTY(BlueprintReadOnly, ReplicatedUsing = OnRep_Shield, Category = "Attributes", meta = (AllowPrivateAccess = true))
 	FGameplayAttributeData Shield;
 	ATTRIBUTE_ACCESSORS(UTDSHealthSet, Shield);
 	
-	UPROPERTY(BlueprintReadOnly, ReplicatedUsing = OnRep_MaxHealth, Category = "Attributes", meta = (AllowPrivateAccess = true))
+	UPROPERTY(BlueprintReadOnly, ReplicatedUsing = OnRep_MaxShield, Category = "Attributes", meta = (AllowPrivateAccess = true))
 	FGameplayAttributeData MaxShield;
 	ATTRIBUTE_ACCESSORS(UTDSHealthSet, MaxShield);
 	
-	UPROPERTY(BlueprintReadOnly, ReplicatedUsing = OnRep_MaxHealth, Category = "Attributes", meta = (AllowPrivateAccess = true))
+	UPROPERTY(BlueprintReadOnly, ReplicatedUsing = OnRep_ShieldRegen, Category = "Attributes", meta = (AllowPrivateAccess = true))
 	FGameplayAttributeData ShieldRegen;
 	ATTRIBUTE_ACCESSORS(UTDSHealthSet, ShieldRegen);
 	
-	UPROPERTY(BlueprintReadOnly, ReplicatedUsing = OnRep_MaxHealth, Category = "Attributes", meta = (AllowPrivateAccess = true))
+	UPROPERTY(BlueprintReadOnly, ReplicatedUsing = OnRep_ShieldRegenDelay, Category = "Attributes", meta = (AllowPrivateAccess = true))
 	FGameplayAttributeData ShieldRegenDelay;
 	ATTRIBUTE_ACCESSORS(UTDSHealthSet, ShieldRegenDelay);
 
-	UPROPERTY(BlueprintReadOnly, ReplicatedUsing = OnRep_MaxHealth, Category = "Attributes", meta = (AllowPrivateAccess = true))
+	/** Meta attribute, consumed on the server in the same execution that sets it and never replicated. */
+	UPROPERTY(BlueprintReadOnly, Category = "Attributes", meta = (AllowPrivateAccess = true))
 	FGameplayAttributeData InDamage;
 	ATTRIBUTE_ACCESSORS(UTDSHealthSet, InDamage);
+
+	/** Takes damage from the shield first and the rest from health. Shared by damage execution and client prediction. */
+	static void SplitDamage(float Damage, float& InOutShield, float& InOutHealth);
 	
 protected:
-	virtual void ClampAttributeOnChange(const FGameplayAttribute& Attribute, float& NewValue) const override;
-	virtual void GetLifetimeReplicatedProps(TArray< FLifetimeProperty > & OutLifetimeProps) const override;
+	virtual void DeclareAttributes(FTDSAttributeTable& Table) const override;
 
 	virtual void PostGameplayEffectExecute(const FGameplayEffectModCallbackData& Data) override;
+
+	/** Damage event, plus a kill or destructible death when this hit took the last health. */
+	void RecordDamageTelemetry(const FGameplayEffectModCallbackData& Data, float Damage, bool bKilled) const;
 	
 	UFUNCTION()
 	virtual void OnRep_Health(const FGameplayAttributeData& OldHealth);
@@ -69,7 +75,4 @@ protected:
 
 	UFUNCTION()
 	virtual void OnRep_ShieldRegenDelay(const FGameplayAttributeData& OldShieldRegenDelay);
-
-	UFUNCTION()
-	virtual void OnRep_InDamage(const FGameplayAttributeData& OldInDamage);
 };
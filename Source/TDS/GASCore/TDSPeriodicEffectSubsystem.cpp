@@ -0,0 +1,91 @@
+// Copyright, The Lounge
+
+
+#include "TDSPeriodicEffectSubsystem.h"
+#include "AbilitySystemComponent.h"
+#include "Engine/World.h"
+#include "TimerManager.h"
+#include "../Core/TDSSimulationScheduler.h"
+
+void UTDSPeriodicEffectSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	UTDSSimulationScheduler* Scheduler = InWorld.GetSubsystem<UTDSSimulationScheduler>();
+	if(!Scheduler || !Scheduler->IsFixedStep()) return;
+
+	Scheduler->RegisterSystem(TEXT("PeriodicEffects"), ETDSSchedulePriority::Critical, FTDSScheduledStep::CreateUObject(this, &UTDSPeriodicEffectSubsystem::StepPeriodicEffects));
+	bStepped = true;
+}
+
+void UTDSPeriodicEffectSubsystem::Deinitialize()
+{
+	AbilitySystemComponents.Reset();
+	PeriodTimes.Reset();
+
+	Super::Deinitialize();
+}
+
+void UTDSPeriodicEffectSubsystem::Register(UAbilitySystemComponent* AbilitySystemComponent)
+{
+	if(!bStepped || !AbilitySystemComponent || !AbilitySystemComponent->IsOwnerActorAuthoritative()) return;
+
+	AbilitySystemComponents.AddUnique(AbilitySystemComponent);
+}
+
+void UTDSPeriodicEffectSubsystem::StepPeriodicEffects(float StepTime)
+{
+	UWorld* World = GetWorld();
+	if(!World) return;
+
+	FTimerManager& TimerManager = World->GetTimerManager();
+	AbilitySystemComponents.RemoveAll([](const TWeakObjectPtr<UAbilitySystemComponent>& AbilitySystemComponent) { return !AbilitySystemComponent.IsValid(); });
+
+	TSet<FActiveGameplayEffectHandle> SteppedEffects;
+	TArray<FActiveGameplayEffectHandle, TInlineAllocator<8>> DueEffects;
+	for(const TWeakObjectPtr<UAbilitySystemComponent>& WeakAbilitySystemComponent : AbilitySystemComponents)
+	{
+		UAbilitySystemComponent* AbilitySystemComponent = WeakAbilitySystemComponent.Get();
+
+		DueEffects.Reset();
+		for(FActiveGameplayEffectsContainer::ConstIterator It = AbilitySystemComponent->GetActiveGameplayEffects().CreateConstIterator(); It; ++It)
+		{
+			const FActiveGameplayEffect& ActiveEffect = *It;
+			const float Period = ActiveEffect.GetPeriod();
+			if(Period <= 0.0f || ActiveEffect.IsPendingRemove) continue;
+
+			SteppedEffects.Add(ActiveEffect.Handle);
+			float& PeriodTime = PeriodTimes.FindOrAdd(ActiveEffect.Handle, 0.0f);
+
+			// A freshly armed timer means the effect was just added or uninhibited, its period starts over here
+			if(TimerManager.IsTimerActive(ActiveEffect.PeriodHandle))
+			{
+				FTimerHandle PeriodHandle = ActiveEffect.PeriodHandle;
+				TimerManager.ClearTimer(PeriodHandle);
+				PeriodTime = 0.0f;
+			}
+			if(ActiveEffect.bIsInhibited) continue;
+
+			PeriodTime += StepTime;
+			while(PeriodTime >= Period)
+			{
+				PeriodTime -= Period;
+				DueEffects.Add(ActiveEffect.Handle);
+			}
+		}
+
+		// Executing changes the container, not while iterating it
+		for(const FActiveGameplayEffectHandle& Handle : DueEffects)
+		{
+			AbilitySystemComponent->ExecutePeriodicEffect(Handle);
+		}
+	}
+
+	for(TMap<FActiveGameplayEffectHandle, float>::TIterator It = PeriodTimes.CreateIterator(); It; ++It)
+	{
+		if(!SteppedEffects.Contains(It.Key()))
+		{
+			It.RemoveCurrent();
+		}
+	}
+}
@@ -0,0 +1,40 @@
+// Copyright, The Lounge
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ActiveGameplayEffectHandle.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "TDSPeriodicEffectSubsystem.generated.h"
+
+class UAbilitySystemComponent;
+
+/**
+ * Runs the periods of periodic gameplay effects, shield regen among them, from a Critical system of
+ * UTDSSimulationScheduler on the server instead of world timers. Regen then advances with the same fixed
+ * step as fire and damage, and loses the same time when a starved server drops steps.
+ *
+ * GAS arms a period timer when an effect is added or uninhibited. Registered ASCs have those timers cleared
+ * on the next step and their periods counted here. Clients and standalone worlds keep the timers.
+ */
+UCLASS()
+class TDS_API UTDSPeriodicEffectSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+
+	/** Server only, a no-op on worlds without a fixed step. */
+	void Register(UAbilitySystemComponent* AbilitySystemComponent);
+
+private:
+	void StepPeriodicEffects(float StepTime);
+
+	bool bStepped{false};
+	TArray<TWeakObjectPtr<UAbilitySystemComponent>> AbilitySystemComponents;
+
+	/** Time towards the next period of each stepped effect. */
+	TMap<FActiveGameplayEffectHandle, float> PeriodTimes;
+};
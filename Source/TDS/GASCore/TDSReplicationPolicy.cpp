@@ -0,0 +1,42 @@
+// Copyright, The Lounge
+
+
+#include "TDSReplicationPolicy.h"
+#include "AbilitySystemComponent.h"
+#include "GameplayTagsManager.h"
+
+DEFINE_LOG_CATEGORY(LogTDSReplication);
+
+namespace TDSReplicationPolicy
+{
+	void ConfigurePlayerASC(UAbilitySystemComponent* AbilitySystemComponent)
+	{
+		if(!AbilitySystemComponent) return;
+
+		// Mixed needs the owner actor's owner to be the controller, true for the player state
+		AbilitySystemComponent->SetIsReplicated(true);
+		AbilitySystemComponent->SetReplicationMode(EGameplayEffectReplicationMode::Mixed);
+	}
+
+	void ConfigureWorldASC(UAbilitySystemComponent* AbilitySystemComponent)
+	{
+		if(!AbilitySystemComponent) return;
+
+		AbilitySystemComponent->SetIsReplicated(true);
+		AbilitySystemComponent->SetReplicationMode(EGameplayEffectReplicationMode::Minimal);
+	}
+
+	uint32 GetTagManifestHash()
+	{
+		return UGameplayTagsManager::Get().GetNetworkGameplayTagNodeIndexHash();
+	}
+
+	bool VerifyTagManifest(uint32 ServerHash)
+	{
+		const uint32 LocalHash = GetTagManifestHash();
+		if(LocalHash == ServerHash) return true;
+
+		UE_LOG(LogTDSReplication, Error, TEXT("Gameplay tag manifest mismatch, server %08x, client %08x. Client and server were built with different tags."), ServerHash, LocalHash);
+		return false;
+	}
+}
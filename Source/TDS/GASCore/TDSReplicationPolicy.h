@@ -0,0 +1,29 @@
+// Copyright, The Lounge
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UAbilitySystemComponent;
+
+DECLARE_LOG_CATEGORY_EXTERN(LogTDSReplication, Log, All);
+
+/**
+ * How TDS ASCs replicate. Effect state goes only to whoever predicts against it, everyone else gets
+ * tags, cues and attributes. Tags go out as network indices, the manifest hash makes sure both sides
+ * assigned the same ones.
+ */
+namespace TDSReplicationPolicy
+{
+	/** Player ASCs: the owning client gets full effect state, simulated proxies only tags and cues. */
+	TDS_API void ConfigurePlayerASC(UAbilitySystemComponent* AbilitySystemComponent);
+
+	/** ASCs of world actors nobody predicts against, destructibles: tags and cues only. */
+	TDS_API void ConfigureWorldASC(UAbilitySystemComponent* AbilitySystemComponent);
+
+	/** Hash of the gameplay tag network index table. */
+	TDS_API uint32 GetTagManifestHash();
+
+	/** Compares the server's manifest with this client's, indices decoded against another table resolve to the wrong tags. */
+	TDS_API bool VerifyTagManifest(uint32 ServerHash);
+}
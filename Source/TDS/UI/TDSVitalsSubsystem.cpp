@@ -0,0 +1,54 @@
+// Copyright, The Lounge
+
+
+#include "TDSVitalsSubsystem.h"
+#include "TDSVitalsViewModel.h"
+
+void UTDSVitalsSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	// Listeners may change attributes again, those changes go out next frame
+	Swap(DirtyViewModels, FlushingViewModels);
+	for(const TWeakObjectPtr<UTDSVitalsViewModel>& ViewModel : FlushingViewModels)
+	{
+		if(ViewModel.IsValid())
+		{
+			ViewModel->Flush();
+		}
+	}
+	FlushingViewModels.Reset();
+}
+
+TStatId UTDSVitalsSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UTDSVitalsSubsystem, STATGROUP_Tickables);
+}
+
+void UTDSVitalsSubsystem::MarkDirty(UTDSVitalsViewModel* ViewModel)
+{
+	DirtyViewModels.Add(ViewModel);
+}
+
+void UTDSVitalsSubsystem::Register(UTDSVitalsViewModel* ViewModel)
+{
+	ViewModelsByASC.Add(ViewModel->GetAbilitySystemComponent(), ViewModel);
+}
+
+void UTDSVitalsSubsystem::Unregister(UTDSVitalsViewModel* ViewModel)
+{
+	// The view model's ASC may already be gone, drop its entries by value along with any stale ones
+	for(auto It = ViewModelsByASC.CreateIterator(); It; ++It)
+	{
+		if(!It->Value.IsValid() || It->Value == ViewModel)
+		{
+			It.RemoveCurrent();
+		}
+	}
+}
+
+UTDSVitalsViewModel* UTDSVitalsSubsystem::FindViewModel(const UAbilitySystemComponent* AbilitySystemComponent) const
+{
+	const TWeakObjectPtr<UTDSVitalsViewModel>* ViewModel = ViewModelsByASC.Find(AbilitySystemComponent);
+	return ViewModel ? ViewModel->Get() : nullptr;
+}
@@ -0,0 +1,38 @@
+// Copyright, The Lounge
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "UObject/ObjectKey.h"
+#include "TDSVitalsSubsystem.generated.h"
+
+class UTDSVitalsViewModel;
+class UAbilitySystemComponent;
+
+/**
+ * Flushes dirty vitals view models once per frame.
+ */
+UCLASS()
+class TDS_API UTDSVitalsSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	void MarkDirty(UTDSVitalsViewModel* ViewModel);
+
+	void Register(UTDSVitalsViewModel* ViewModel);
+	void Unregister(UTDSVitalsViewModel* ViewModel);
+
+	/** View model bound to an actor's ASC, used to show predicted hits on it. */
+	UTDSVitalsViewModel* FindViewModel(const UAbilitySystemComponent* AbilitySystemComponent) const;
+
+private:
+	TMap<TObjectKey<UAbilitySystemComponent>, TWeakObjectPtr<UTDSVitalsViewModel>> ViewModelsByASC;
+
+	TArray<TWeakObjectPtr<UTDSVitalsViewModel>> DirtyViewModels;
+	TArray<TWeakObjectPtr<UTDSVitalsViewModel>> FlushingViewModels;
+};
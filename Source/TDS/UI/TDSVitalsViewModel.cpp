@@ -0,0 +1,173 @@
+// Copyright, The Lounge
+
+
+#include "TDSVitalsViewModel.h"
+#include "TDSVitalsSubsystem.h"
+#include "AbilitySystemComponent.h"
+#include "../GASCore/TDSHealthSet.h"
+
+void UTDSVitalsViewModel::Bind(UAbilitySystemComponent* InAbilitySystemComponent)
+{
+	if(AbilitySystemComponent == InAbilitySystemComponent) return;
+
+	Unbind();
+
+	AbilitySystemComponent = InAbilitySystemComponent;
+	if(!InAbilitySystemComponent) return;
+
+	const FGameplayAttribute Attributes[] = {
+		UTDSHealthSet::GetHealthAttribute(),
+		UTDSHealthSet::GetMaxHealthAttribute(),
+		UTDSHealthSet::GetShieldAttribute(),
+		UTDSHealthSet::GetMaxShieldAttribute()
+	};
+	for(const FGameplayAttribute& Attribute : Attributes)
+	{
+		const FDelegateHandle Handle = InAbilitySystemComponent->GetGameplayAttributeValueChangeDelegate(Attribute).AddUObject(this, &UTDSVitalsViewModel::OnAttributeChanged);
+		AttributeHandles.Emplace(Attribute, Handle);
+	}
+
+	if(UTDSVitalsSubsystem* VitalsSubsystem = GetWorld() ? GetWorld()->GetSubsystem<UTDSVitalsSubsystem>() : nullptr)
+	{
+		VitalsSubsystem->Register(this);
+	}
+
+	// Starting values are not a change, listeners read them through GetVitals
+	AuthoritativeVitals.Health = InAbilitySystemComponent->GetNumericAttribute(UTDSHealthSet::GetHealthAttribute());
+	AuthoritativeVitals.MaxHealth = InAbilitySystemComponent->GetNumericAttribute(UTDSHealthSet::GetMaxHealthAttribute());
+	AuthoritativeVitals.Shield = InAbilitySystemComponent->GetNumericAttribute(UTDSHealthSet::GetShieldAttribute());
+	AuthoritativeVitals.MaxShield = InAbilitySystemComponent->GetNumericAttribute(UTDSHealthSet::GetMaxShieldAttribute());
+	Vitals = AuthoritativeVitals;
+	AuthoritativeLoss = 0.0f;
+	PredictedDamage.Reset();
+}
+
+void UTDSVitalsViewModel::Unbind()
+{
+	if(UAbilitySystemComponent* ASC = AbilitySystemComponent.Get())
+	{
+		for(const TPair<FGameplayAttribute, FDelegateHandle>& AttributeHandle : AttributeHandles)
+		{
+			ASC->GetGameplayAttributeValueChangeDelegate(AttributeHandle.Key).Remove(AttributeHandle.Value);
+		}
+	}
+
+	// Also when the ASC is already gone, its entry must not outlive it
+	if(UTDSVitalsSubsystem* VitalsSubsystem = GetWorld() ? GetWorld()->GetSubsystem<UTDSVitalsSubsystem>() : nullptr)
+	{
+		VitalsSubsystem->Unregister(this);
+	}
+	AttributeHandles.Reset();
+	AbilitySystemComponent.Reset();
+}
+
+void UTDSVitalsViewModel::Flush()
+{
+	bDirty = false;
+
+	FTDSVitals NewVitals = AuthoritativeVitals;
+	if(PredictedDamage.Num() > 0)
+	{
+		ReconcilePredictions();
+
+		float TotalPredicted = 0.0f;
+		for(const FPredictedDamage& Prediction : PredictedDamage)
+		{
+			TotalPredicted += Prediction.Damage;
+		}
+		UTDSHealthSet::SplitDamage(TotalPredicted, NewVitals.Shield, NewVitals.Health);
+
+		// Keep flushing until every prediction is confirmed or timed out
+		if(PredictedDamage.Num() > 0)
+		{
+			MarkDirty();
+		}
+	}
+	AuthoritativeLoss = 0.0f;
+
+	if(NewVitals == Vitals) return;
+
+	const FTDSVitals OldVitals = Vitals;
+	Vitals = NewVitals;
+
+	OnVitalsChangedNative.Broadcast(OldVitals, Vitals);
+	OnVitalsChanged.Broadcast(OldVitals, Vitals);
+}
+
+void UTDSVitalsViewModel::BeginDestroy()
+{
+	Unbind();
+
+	Super::BeginDestroy();
+}
+
+void UTDSVitalsViewModel::OnAttributeChanged(const FOnAttributeChangeData& Data)
+{
+	if(Data.Attribute == UTDSHealthSet::GetHealthAttribute() || Data.Attribute == UTDSHealthSet::GetShieldAttribute())
+	{
+		AuthoritativeLoss += FMath::Max(Data.OldValue - Data.NewValue, 0.0f);
+	}
+
+	if(Data.Attribute == UTDSHealthSet::GetHealthAttribute())
+	{
+		AuthoritativeVitals.Health = Data.NewValue;
+	}
+	else if(Data.Attribute == UTDSHealthSet::GetMaxHealthAttribute())
+	{
+		AuthoritativeVitals.MaxHealth = Data.NewValue;
+	}
+	else if(Data.Attribute == UTDSHealthSet::GetShieldAttribute())
+	{
+		AuthoritativeVitals.Shield = Data.NewValue;
+	}
+	else if(Data.Attribute == UTDSHealthSet::GetMaxShieldAttribute())
+	{
+		AuthoritativeVitals.MaxShield = Data.NewValue;
+	}
+
+	MarkDirty();
+}
+
+void UTDSVitalsViewModel::AddPredictedDamage(float Damage, float TimeoutSeconds)
+{
+	const UWorld* World = GetWorld();
+	if(!World || Damage <= 0.0f) return;
+
+	PredictedDamage.Add({Damage, World->GetTimeSeconds() + TimeoutSeconds});
+	MarkDirty();
+}
+
+void UTDSVitalsViewModel::ReconcilePredictions()
+{
+	// Any authoritative loss of shield and health confirms the oldest predictions first. Only losses count,
+	// a regen tick in the same window does not offset the hit. Damage from other sources can confirm a
+	// prediction early, the display still converges on the replicated values.
+	float Confirmed = AuthoritativeLoss;
+	while(Confirmed > 0.0f && PredictedDamage.Num() > 0)
+	{
+		FPredictedDamage& Oldest = PredictedDamage[0];
+		const float Consumed = FMath::Min(Oldest.Damage, Confirmed);
+		Oldest.Damage -= Consumed;
+		Confirmed -= Consumed;
+		if(Oldest.Damage <= UE_KINDA_SMALL_NUMBER)
+		{
+			PredictedDamage.RemoveAt(0, 1, false);
+		}
+	}
+
+	// Rolled back, the server never applied these
+	const double Now = GetWorld()->GetTimeSeconds();
+	PredictedDamage.RemoveAll([Now](const FPredictedDamage& Prediction) { return Prediction.ExpireTime <= Now; });
+}
+
+void UTDSVitalsViewModel::MarkDirty()
+{
+	if(bDirty) return;
+
+	UWorld* World = GetWorld();
+	UTDSVitalsSubsystem* VitalsSubsystem = World ? World->GetSubsystem<UTDSVitalsSubsystem>() : nullptr;
+	if(!VitalsSubsystem) return;
+
+	bDirty = true;
+	VitalsSubsystem->MarkDirty(this);
+}
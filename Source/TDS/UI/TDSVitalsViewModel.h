@@ -0,0 +1,101 @@
+// Copyright, The Lounge
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Object.h"
+#include "GameplayEffectTypes.h"
+#include "TDSVitalsViewModel.generated.h"
+
+class UAbilitySystemComponent;
+
+USTRUCT(BlueprintType)
+struct FTDSVitals
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "Vitals")
+	float Health{0.0f};
+
+	UPROPERTY(BlueprintReadOnly, Category = "Vitals")
+	float MaxHealth{0.0f};
+
+	UPROPERTY(BlueprintReadOnly, Category = "Vitals")
+	float Shield{0.0f};
+
+	UPROPERTY(BlueprintReadOnly, Category = "Vitals")
+	float MaxShield{0.0f};
+
+	bool operator==(const FTDSVitals& Other) const
+	{
+		return Health == Other.Health && MaxHealth == Other.MaxHealth && Shield == Other.Shield && MaxShield == Other.MaxShield;
+	}
+	bool operator!=(const FTDSVitals& Other) const { return !(*this == Other); }
+};
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnTDSVitalsChanged, const FTDSVitals&, OldVitals, const FTDSVitals&, NewVitals);
+DECLARE_MULTICAST_DELEGATE_TwoParams(FOnTDSVitalsChangedNative, const FTDSVitals&, const FTDSVitals&);
+
+/**
+ * Health and shield of one actor, for UI. Attribute changes made during a frame are
+ * collected and published once at the end of the frame by UTDSVitalsSubsystem.
+ *
+ * On clients, damage predicted by the local shooter is shown on top of the replicated values until
+ * the server's change arrives, or removed again once it times out because the server rejected the hit.
+ */
+UCLASS(BlueprintType)
+class TDS_API UTDSVitalsViewModel : public UObject
+{
+	GENERATED_BODY()
+
+public:
+	void Bind(UAbilitySystemComponent* InAbilitySystemComponent);
+	void Unbind();
+
+	UFUNCTION(BlueprintPure, Category = "Vitals")
+	const FTDSVitals& GetVitals() const { return Vitals; }
+
+	/** Publishes the changes collected since the last flush. */
+	void Flush();
+
+	/** Shows Damage right away, split over shield and health the way UTDSHealthSet applies it. */
+	void AddPredictedDamage(float Damage, float TimeoutSeconds);
+
+	UAbilitySystemComponent* GetAbilitySystemComponent() const { return AbilitySystemComponent.Get(); }
+
+	UPROPERTY(BlueprintAssignable, Category = "Vitals")
+	FOnTDSVitalsChanged OnVitalsChanged;
+
+	FOnTDSVitalsChangedNative OnVitalsChangedNative;
+
+	virtual void BeginDestroy() override;
+
+protected:
+	void OnAttributeChanged(const FOnAttributeChangeData& Data);
+	void MarkDirty();
+
+	/** Drops predictions covered by authoritative damage and those that timed out. */
+	void ReconcilePredictions();
+
+private:
+	struct FPredictedDamage
+	{
+		float Damage;
+		double ExpireTime;
+	};
+
+	TWeakObjectPtr<UAbilitySystemComponent> AbilitySystemComponent;
+	TArray<TPair<FGameplayAttribute, FDelegateHandle>, TInlineAllocator<4>> AttributeHandles;
+
+	/** Last published values. */
+	FTDSVitals Vitals;
+
+	/** Replicated values. */
+	FTDSVitals AuthoritativeVitals;
+
+	/** Health and shield lost since the previous flush. Gains are left out, regen must not hide a confirmed hit. */
+	float AuthoritativeLoss{0.0f};
+
+	TArray<FPredictedDamage, TInlineAllocator<4>> PredictedDamage;
+	bool bDirty{false};
+};
@@ -0,0 +1,263 @@
+// Copyright, The Lounge
+
+
+#include "TDSTraceBatchSubsystem.h"
+#include "AbilitySystemComponent.h"
+#include "AbilitySystemGlobals.h"
+#include "../GASCore/TDSGameplayTags.h"
+#include "../GASCore/TDSCombatSet.h"
+#include "../GASCore/TDSDamageExecution.h"
+#include "../GASCore/TDSCueBatchSubsystem.h"
+#include "../Core/TDSSimulationScheduler.h"
+#include "../UI/TDSVitalsSubsystem.h"
+#include "../UI/TDSVitalsViewModel.h"
+
+void UTDSTraceBatchSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	if(UTDSSimulationScheduler* Scheduler = InWorld.GetSubsystem<UTDSSimulationScheduler>())
+	{
+		Scheduler->RegisterSystem(TEXT("DamageResolution"), ETDSSchedulePriority::Critical, FTDSScheduledStep::CreateUObject(this, &UTDSTraceBatchSubsystem::ResolveBatches));
+	}
+}
+
+void UTDSTraceBatchSubsystem::ResolveBatches(float DeltaTime)
+{
+	UWorld* World = GetWorld();
+	if(!World || PendingBatches.Num() == 0) return;
+
+	// Pull finished batches out first, callbacks are allowed to submit new ones
+	TArray<FPendingBatch, TInlineAllocator<16>> ReadyBatches;
+	TArray<TArray<FHitResult>, TInlineAllocator<16>> ReadyHits;
+
+	FTraceDatum Datum;
+	for(int32 BatchIndex = 0; BatchIndex < PendingBatches.Num(); ++BatchIndex)
+	{
+		FPendingBatch& Batch = PendingBatches[BatchIndex];
+
+		ResolvedHits.Reset(Batch.Handles.Num());
+		bool bReady = true;
+		for(const FTraceHandle& Handle : Batch.Handles)
+		{
+			if(World->QueryTraceData(Handle, Datum))
+			{
+				ResolvedHits.Add(Datum.OutHits.Num() > 0 ? Datum.OutHits[0] : FHitResult());
+			}
+			else if(!World->IsTraceHandleValid(Handle, false))
+			{
+				// Expired without data, count as a miss
+				ResolvedHits.Add(FHitResult());
+			}
+			else
+			{
+				bReady = false;
+				break;
+			}
+		}
+
+		if(bReady)
+		{
+			ReadyHits.Add(ResolvedHits);
+			ReadyBatches.Add(MoveTemp(Batch));
+			PendingBatches.RemoveAtSwap(BatchIndex--, 1, false);
+		}
+	}
+
+	for(int32 BatchIndex = 0; BatchIndex < ReadyBatches.Num(); ++BatchIndex)
+	{
+		ReadyBatches[BatchIndex].OnResolved.ExecuteIfBound(ReadyHits[BatchIndex]);
+	}
+}
+
+void UTDSTraceBatchSubsystem::Deinitialize()
+{
+	PendingBatches.Reset();
+
+	Super::Deinitialize();
+}
+
+void UTDSTraceBatchSubsystem::SubmitBatch(TConstArrayView<FTDSTraceRequest> Requests, ECollisionChannel Channel, const FCollisionQueryParams& Params, FTDSTraceBatchResolved OnResolved)
+{
+	UWorld* World = GetWorld();
+	if(!World || Requests.Num() == 0) return;
+
+	// The world buffers every async trace issued this frame and runs them in one parallel dispatch
+	FPendingBatch& Batch = PendingBatches.AddDefaulted_GetRef();
+	Batch.OnResolved = MoveTemp(OnResolved);
+	for(const FTDSTraceRequest& Request : Requests)
+	{
+		Batch.Handles.Add(World->AsyncLineTraceByChannel(EAsyncTraceType::Single, Request.Start, Request.End, Channel, Params));
+	}
+}
+
+void UTDSTraceBatchSubsystem::SubmitDamageBatch(AActor* Instigator, const TArray<FTDSTraceRequest>& Requests, TSubclassOf<UGameplayEffect> DamageEffect, float Damage, FGameplayTag ImpactCueTag)
+{
+	if(!Instigator || !Instigator->HasAuthority() || !DamageEffect) return;
+
+	UAbilitySystemComponent* SourceASC = UAbilitySystemGlobals::GetAbilitySystemComponentFromActor(Instigator);
+	if(!SourceASC) return;
+
+	FCollisionQueryParams Params(SCENE_QUERY_STAT(TDSWeaponTrace), false, Instigator);
+	for(AActor* Child : Instigator->Children)
+	{
+		Params.AddIgnoredActor(Child);
+	}
+
+	SubmitBatch(Requests, ECC_Visibility, Params, FTDSTraceBatchResolved::CreateWeakLambda(SourceASC, [this, SourceASC, DamageEffect, Damage, ImpactCueTag](TArrayView<const FHitResult> Hits)
+	{
+		ApplyDamageFromHits(SourceASC, DamageEffect, Damage, Hits);
+
+		UTDSCueBatchSubsystem* CueBatch = ImpactCueTag.IsValid() && GetWorld() ? GetWorld()->GetSubsystem<UTDSCueBatchSubsystem>() : nullptr;
+		if(!CueBatch) return;
+
+		for(const FHitResult& Hit : Hits)
+		{
+			if(Hit.bBlockingHit)
+			{
+				CueBatch->QueueCue(Hit.GetActor(), ImpactCueTag, Hit.ImpactPoint, Hit.ImpactNormal);
+			}
+		}
+	}));
+}
+
+namespace TDSTraceDamage
+{
+	struct FTargetDamage
+	{
+		UAbilitySystemComponent* Target;
+		float Damage;
+		int32 FirstHit;
+	};
+	using FTargetDamageArray = TArray<FTargetDamage, TInlineAllocator<8>>;
+
+	/** One entry per damaged ASC, pellets hitting the same target are summed. */
+	static void GatherTargets(float Damage, TArrayView<const FHitResult> Hits, FTargetDamageArray& OutTargets)
+	{
+		for(int32 HitIndex = 0; HitIndex < Hits.Num(); ++HitIndex)
+		{
+			const FHitResult& Hit = Hits[HitIndex];
+			if(!Hit.bBlockingHit) continue;
+
+			UAbilitySystemComponent* TargetASC = UAbilitySystemGlobals::GetAbilitySystemComponentFromActor(Hit.GetActor());
+			if(!TargetASC) continue;
+
+			if(FTargetDamage* Existing = OutTargets.FindByPredicate([TargetASC](const FTargetDamage& Entry) { return Entry.Target == TargetASC; }))
+			{
+				Existing->Damage += Damage;
+			}
+			else
+			{
+				OutTargets.Add({TargetASC, Damage, HitIndex});
+			}
+		}
+	}
+
+	static const UTDSDamageExecution* FindDamageExecution(TSubclassOf<UGameplayEffect> DamageEffect)
+	{
+		for(const FGameplayEffectExecutionDefinition& Execution : DamageEffect.GetDefaultObject()->Executions)
+		{
+			if(Execution.CalculationClass && Execution.CalculationClass->IsChildOf<UTDSDamageExecution>())
+			{
+				return Execution.CalculationClass->GetDefaultObject<UTDSDamageExecution>();
+			}
+		}
+		return nullptr;
+	}
+
+	/** Scales every target's damage by the execution in one batched pass. */
+	static void EvaluateTargets(const UTDSDamageExecution& DamageExecution, const UAbilitySystemComponent* SourceASC, bool bAllowCrits, TArrayView<const FHitResult> Hits, FTargetDamageArray& Targets)
+	{
+		FTDSDamageShot Shot;
+		Shot.BaseDamage = 1.0f;
+		Shot.CritChance = bAllowCrits && SourceASC ? SourceASC->GetNumericAttribute(UTDSCombatSet::GetCritChanceAttribute()) : 0.0f;
+		Shot.CritMultiplier = SourceASC ? SourceASC->GetNumericAttribute(UTDSCombatSet::GetCritMultiplierAttribute()) : 1.0f;
+		Shot.Seed = FMath::Rand();
+
+		FTDSDamageTargets PackedTargets;
+		PackedTargets.Reset(Targets.Num());
+		for(const FTargetDamage& Target : Targets)
+		{
+			const FHitResult& Hit = Hits[Target.FirstHit];
+			PackedTargets.Add(
+				Target.Target->GetNumericAttribute(UTDSCombatSet::GetArmorAttribute()),
+				Target.Target->GetNumericAttribute(UTDSCombatSet::GetDamageResistanceAttribute()),
+				FVector::Dist(Hit.TraceStart, Hit.ImpactPoint));
+		}
+
+		// Base damage differs per target when pellets were summed, evaluate multipliers and scale
+		TArray<float> Multipliers;
+		DamageExecution.EvaluateBatch(Shot, PackedTargets, Multipliers);
+		for(int32 TargetIndex = 0; TargetIndex < Targets.Num(); ++TargetIndex)
+		{
+			Targets[TargetIndex].Damage *= Multipliers[TargetIndex];
+		}
+	}
+}
+
+void UTDSTraceBatchSubsystem::ApplyDamageFromHits(UAbilitySystemComponent* SourceASC, TSubclassOf<UGameplayEffect> DamageEffect, float Damage, TArrayView<const FHitResult> Hits)
+{
+	if(!SourceASC || !DamageEffect || !SourceASC->IsOwnerActorAuthoritative()) return;
+
+	TDSTraceDamage::FTargetDamageArray Targets;
+	TDSTraceDamage::GatherTargets(Damage, Hits, Targets);
+
+	// Effects running the TDS damage execution get every target resolved in one batched pass
+	const UTDSDamageExecution* DamageExecution = TDSTraceDamage::FindDamageExecution(DamageEffect);
+	if(DamageExecution)
+	{
+		TDSTraceDamage::EvaluateTargets(*DamageExecution, SourceASC, true, Hits, Targets);
+	}
+
+	for(const TDSTraceDamage::FTargetDamage& Target : Targets)
+	{
+		FGameplayEffectContextHandle EffectContext = SourceASC->MakeEffectContext();
+		EffectContext.AddHitResult(Hits[Target.FirstHit]);
+
+		FGameplayEffectSpecHandle SpecHandle = SourceASC->MakeOutgoingSpec(DamageEffect, 1, EffectContext);
+		if(SpecHandle.IsValid())
+		{
+			SpecHandle.Data->SetSetByCallerMagnitude(TDSGameplayTags::Damage_SetByCaller, Target.Damage);
+			if(DamageExecution)
+			{
+				SpecHandle.Data->AddDynamicAssetTag(TDSGameplayTags::Damage_Resolved);
+			}
+			SourceASC->ApplyGameplayEffectSpecToTarget(*SpecHandle.Data.Get(), Target.Target);
+		}
+	}
+}
+
+void UTDSTraceBatchSubsystem::SubmitPredictionBatch(AActor* Instigator, const TArray<FTDSTraceRequest>& Requests, TSubclassOf<UGameplayEffect> DamageEffect, float Damage, float TimeoutSeconds)
+{
+	if(!Instigator || Instigator->HasAuthority() || !DamageEffect) return;
+
+	FCollisionQueryParams Params(SCENE_QUERY_STAT(TDSWeaponTrace), false, Instigator);
+	for(AActor* Child : Instigator->Children)
+	{
+		Params.AddIgnoredActor(Child);
+	}
+
+	TWeakObjectPtr<UAbilitySystemComponent> WeakSourceASC = UAbilitySystemGlobals::GetAbilitySystemComponentFromActor(Instigator);
+	SubmitBatch(Requests, ECC_Visibility, Params, FTDSTraceBatchResolved::CreateWeakLambda(this, [this, WeakSourceASC, DamageEffect, Damage, TimeoutSeconds](TArrayView<const FHitResult> Hits)
+	{
+		UTDSVitalsSubsystem* VitalsSubsystem = GetWorld() ? GetWorld()->GetSubsystem<UTDSVitalsSubsystem>() : nullptr;
+		if(!VitalsSubsystem) return;
+
+		TDSTraceDamage::FTargetDamageArray Targets;
+		TDSTraceDamage::GatherTargets(Damage, Hits, Targets);
+
+		// Crits are rolled on the server only, predict the plain hit
+		if(const UTDSDamageExecution* DamageExecution = TDSTraceDamage::FindDamageExecution(DamageEffect))
+		{
+			TDSTraceDamage::EvaluateTargets(*DamageExecution, WeakSourceASC.Get(), false, Hits, Targets);
+		}
+
+		for(const TDSTraceDamage::FTargetDamage& Target : Targets)
+		{
+			if(UTDSVitalsViewModel* ViewModel = VitalsSubsystem->FindViewModel(Target.Target))
+			{
+				ViewModel->AddPredictedDamage(Target.Damage, TimeoutSeconds);
+			}
+		}
+	}));
+}
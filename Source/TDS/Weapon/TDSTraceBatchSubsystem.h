@@ -0,0 +1,73 @@
+// Copyright, The Lounge
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "WorldCollision.h"
+#include "GameplayTagContainer.h"
+#include "TDSTraceBatchSubsystem.generated.h"
+
+class UGameplayEffect;
+class UAbilitySystemComponent;
+
+USTRUCT(BlueprintType)
+struct FTDSTraceRequest
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadWrite, Category = "Trace")
+	FVector Start{FVector::ZeroVector};
+
+	UPROPERTY(BlueprintReadWrite, Category = "Trace")
+	FVector End{FVector::ZeroVector};
+};
+
+/** Receives one hit per request, in submission order. Misses have bBlockingHit unset. */
+DECLARE_DELEGATE_OneParam(FTDSTraceBatchResolved, TArrayView<const FHitResult>);
+
+/**
+ * Collects hitscan traces submitted during a frame and runs them through the async trace API,
+ * so they are executed together off the game thread instead of one synchronous trace per shot.
+ * Results are delivered on a following frame, from a Critical system of UTDSSimulationScheduler
+ * so damage is resolved at the fixed simulation step on the server.
+ */
+UCLASS()
+class TDS_API UTDSTraceBatchSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+
+	void SubmitBatch(TConstArrayView<FTDSTraceRequest> Requests, ECollisionChannel Channel, const FCollisionQueryParams& Params, FTDSTraceBatchResolved OnResolved);
+
+	/**
+	 * Traces on the visibility channel and applies DamageEffect with Damage per hit from the instigator's ASC.
+	 * ImpactCueTag, when set, is queued on UTDSCueBatchSubsystem for every blocking hit. Server only.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Trace")
+	void SubmitDamageBatch(AActor* Instigator, const TArray<FTDSTraceRequest>& Requests, TSubclassOf<UGameplayEffect> DamageEffect, float Damage, FGameplayTag ImpactCueTag);
+
+	/**
+	 * Client side mirror of SubmitDamageBatch. Hits are shown on the targets' vitals as predicted damage,
+	 * nothing is sent to the server. Predictions not confirmed within TimeoutSeconds are rolled back.
+	 */
+	void SubmitPredictionBatch(AActor* Instigator, const TArray<FTDSTraceRequest>& Requests, TSubclassOf<UGameplayEffect> DamageEffect, float Damage, float TimeoutSeconds);
+
+	/** Applies one damage spec per hit target. Pellets hitting the same target are summed into a single application. */
+	static void ApplyDamageFromHits(UAbilitySystemComponent* SourceASC, TSubclassOf<UGameplayEffect> DamageEffect, float Damage, TArrayView<const FHitResult> Hits);
+
+private:
+	void ResolveBatches(float DeltaTime);
+
+	struct FPendingBatch
+	{
+		TArray<FTraceHandle, TInlineAllocator<8>> Handles;
+		FTDSTraceBatchResolved OnResolved;
+	};
+
+	TArray<FPendingBatch> PendingBatches;
+	TArray<FHitResult> ResolvedHits;
+};
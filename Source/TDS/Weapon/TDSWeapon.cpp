@@ -2,6 +2,12 @@
 
 
 #include "TDSWeapon.h"
+#include "TDSWeaponData.h"
+#include "TDSTraceBatchSubsystem.h"
+#include "../GASCore/TDSCueBatchSubsystem.h"
+#include "../Core/TDSSimulationScheduler.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerState.h"
 
 // Sets default values
 ATDSWeapon::ATDSWeapon()
@@ -15,7 +21,81 @@ ATDSWeapon::ATDSWeapon()
 void ATDSWeapon::BeginPlay()
 {
 	Super::BeginPlay();
-	
+
+	SeedStream.GenerateNewSeed();
+
+	if(WeaponData)
+	{
+		Ammo = WeaponData->MagazineSize;
+		FireClock = WeaponData->GetShotInterval();
+	}
+	PreviousMuzzleLocation = GetMuzzleLocation();
+	PreviousAimDirection = GetAimDirection();
+
+	// The server's fire clocks and shot validation advance with the fixed simulation step
+	UTDSSimulationScheduler* Scheduler = GetWorld()->GetSubsystem<UTDSSimulationScheduler>();
+	if(WeaponData && Scheduler && Scheduler->IsFixedStep())
+	{
+		Scheduler->RegisterSystem(GetFName(), ETDSSchedulePriority::Critical, FTDSScheduledStep::CreateUObject(this, &ATDSWeapon::StepFiring));
+		bSteppedFiring = true;
+	}
+}
+
+void ATDSWeapon::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if(bSteppedFiring)
+	{
+		if(UTDSSimulationScheduler* Scheduler = GetWorld()->GetSubsystem<UTDSSimulationScheduler>())
+		{
+			Scheduler->UnregisterSystem(GetFName());
+		}
+		bSteppedFiring = false;
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void ATDSWeapon::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if(WeaponData && !bSteppedFiring)
+	{
+		StepFiring(DeltaTime);
+	}
+}
+
+void ATDSWeapon::StepFiring(float StepTime)
+{
+	if(!WeaponData) return;
+
+	FrameDeltaTime = StepTime;
+	AdvanceFiring(StepTime);
+	PreviousMuzzleLocation = GetMuzzleLocation();
+	PreviousAimDirection = GetAimDirection();
+
+	// One shot may be banked while idle, the tolerance lets late batches arrive together
+	const float ShotInterval = WeaponData->GetShotInterval();
+	RemoteShotBudget = FMath::Min(RemoteShotBudget + StepTime / ShotInterval, 1.0f + RemoteShotTolerance / ShotInterval);
+	TimeSinceRemoteBatch += StepTime;
+
+	BroadcastPendingShots();
+}
+
+void ATDSWeapon::BroadcastPendingShots()
+{
+	if(PendingShots.Num() == 0) return;
+
+	OnShotBatch.Broadcast(this, PendingShots);
+	OnFire(PendingShots);
+	PlayLocalFireCues(PendingShots);
+
+	// The weapon itself is spawned locally, the owner's role tells a remote client apart
+	if(GetOwner() && GetOwner()->GetLocalRole() == ROLE_AutonomousProxy)
+	{
+		PredictShotBatch(PendingShots);
+	}
+	PendingShots.Reset();
 }
 
 void ATDSWeapon::Equip()
@@ -25,8 +105,245 @@ void ATDSWeapon::Equip()
 
 void ATDSWeapon::UnEquip()
 {
+	StopFire();
+	ShotsLeftInBurst = 0;
+
 	OnUnEquip();
 }
 
+#pragma region Firing
+void ATDSWeapon::StartFire()
+{
+	if(!WeaponData || bTriggerHeld) return;
+
+	bTriggerHeld = true;
+	if(WeaponData->BurstCount > 0 && ShotsLeftInBurst == 0)
+	{
+		ShotsLeftInBurst = WeaponData->BurstCount;
+	}
+}
+
+void ATDSWeapon::StopFire()
+{
+	bTriggerHeld = false;
+}
+
+void ATDSWeapon::Reload()
+{
+	if(!WeaponData || IsReloading() || WeaponData->MagazineSize <= 0 || Ammo == WeaponData->MagazineSize) return;
+
+	ReloadRemaining = FMath::Max(WeaponData->ReloadTime, UE_KINDA_SMALL_NUMBER);
+	ShotsLeftInBurst = 0;
+
+	OnReload.Broadcast(this);
+}
+
+bool ATDSWeapon::WantsToFire() const
+{
+	return WeaponData->BurstCount > 0 ? ShotsLeftInBurst > 0 : bTriggerHeld;
+}
+
+void ATDSWeapon::AdvanceFiring(float DeltaTime)
+{
+	const float ShotInterval = WeaponData->GetShotInterval();
+
+	if(IsReloading())
+	{
+		ReloadRemaining -= DeltaTime;
+		if(ReloadRemaining > 0.0f) return;
+
+		// Time left over after the reload finished still counts towards the next shot
+		DeltaTime = -ReloadRemaining;
+		ReloadRemaining = 0.0f;
+		Ammo = WeaponData->MagazineSize;
+	}
+
+	FireClock += DeltaTime;
 
+	// Each shot is placed at its exact time inside the frame, so the fire rate does not depend on the frame rate
+	while(WantsToFire() && FireClock >= ShotInterval)
+	{
+		if(WeaponData->MagazineSize > 0 && Ammo <= 0)
+		{
+			Reload();
+			break;
+		}
+
+		FireClock -= ShotInterval;
+
+		FVector Origin;
+		FVector Direction;
+		GetMuzzleAt(FireClock, Origin, Direction);
+
+		FTDSShot& Shot = PendingShots.AddDefaulted_GetRef();
+		Shot.Origin = Origin;
+		Shot.Direction = Direction;
+		Shot.Age = FireClock;
+		Shot.Seed = SeedStream.GetUnsignedInt();
+
+		if(WeaponData->MagazineSize > 0)
+		{
+			--Ammo;
+		}
+		if(ShotsLeftInBurst > 0)
+		{
+			--ShotsLeftInBurst;
+		}
+	}
+
+	// An idle weapon may bank at most one shot, the next trigger pull fires immediately
+	if(!WantsToFire())
+	{
+		FireClock = FMath::Min(FireClock, ShotInterval);
+	}
+}
 
+void ATDSWeapon::GetPelletDirections(const FTDSShot& Shot, TArray<FVector>& OutDirections) const
+{
+	OutDirections.Reset();
+	if(!WeaponData) return;
+
+	const FRandomStream Stream(Shot.Seed);
+	const float HalfAngle = FMath::DegreesToRadians(WeaponData->SpreadAngle);
+
+	for(int32 Pellet = 0; Pellet < WeaponData->PelletsPerShot; ++Pellet)
+	{
+		OutDirections.Add(HalfAngle > 0.0f ? Stream.VRandCone(Shot.Direction, HalfAngle) : FVector(Shot.Direction));
+	}
+}
+
+void ATDSWeapon::AcceptRemoteShots(TArray<FTDSShot>& Shots)
+{
+	if(!WeaponData)
+	{
+		Shots.Reset();
+		return;
+	}
+
+	// The budget is refilled by StepFiring, a starved server accepts shots at the rate it simulates
+	const float MaxAge = FMath::Min(TimeSinceRemoteBatch, RemoteShotTolerance);
+	TimeSinceRemoteBatch = 0.0f;
+
+	// Only the aim and the seed come from the client, traces start at the server's muzzle so they cannot pass walls
+	const FVector MuzzleLocation = GetMuzzleLocation();
+
+	int32 Accepted = 0;
+	for(FTDSShot& Shot : Shots)
+	{
+		if(IsReloading() || RemoteShotBudget < 1.0f) break;
+		if(WeaponData->MagazineSize > 0 && Ammo <= 0) break;
+
+		RemoteShotBudget -= 1.0f;
+		if(WeaponData->MagazineSize > 0)
+		{
+			--Ammo;
+		}
+
+		Shot.Origin = MuzzleLocation;
+		Shot.Direction = FVector(Shot.Direction).GetSafeNormal(UE_SMALL_NUMBER, GetAimDirection());
+		Shot.Age = FMath::Clamp(Shot.Age, 0.0f, MaxAge);
+		Shots[Accepted++] = Shot;
+	}
+
+	Shots.SetNum(Accepted);
+}
+
+void ATDSWeapon::HandleShotBatch(const TArray<FTDSShot>& Shots)
+{
+	QueueFireCues(Shots);
+
+	UTDSTraceBatchSubsystem* TraceBatch = GetWorld() ? GetWorld()->GetSubsystem<UTDSTraceBatchSubsystem>() : nullptr;
+	if(!WeaponData || !WeaponData->DamageEffect || !TraceBatch)
+	{
+		OnResolveShots(Shots);
+		return;
+	}
+
+	TArray<FTDSTraceRequest> Requests;
+	BuildTraceRequests(Shots, Requests);
+
+	TraceBatch->SubmitDamageBatch(GetOwner(), Requests, WeaponData->DamageEffect, WeaponData->Damage, WeaponData->ImpactCueTag);
+}
+
+void ATDSWeapon::PlayLocalFireCues(const TArray<FTDSShot>& Shots) const
+{
+	const APawn* OwnerPawn = Cast<APawn>(GetOwner());
+	if(!WeaponData->FireCueTag.IsValid() || !OwnerPawn || !OwnerPawn->IsLocallyControlled()) return;
+
+	for(const FTDSShot& Shot : Shots)
+	{
+		UTDSCueBatchSubsystem::ExecuteCue(GetOwner(), WeaponData->FireCueTag, Shot.Origin, Shot.Direction);
+	}
+}
+
+void ATDSWeapon::QueueFireCues(const TArray<FTDSShot>& Shots) const
+{
+	UTDSCueBatchSubsystem* CueBatch = GetWorld() ? GetWorld()->GetSubsystem<UTDSCueBatchSubsystem>() : nullptr;
+	if(!CueBatch || !WeaponData || !WeaponData->FireCueTag.IsValid()) return;
+
+	// The shooter already played these in Tick
+	APawn* OwnerPawn = Cast<APawn>(GetOwner());
+	for(const FTDSShot& Shot : Shots)
+	{
+		CueBatch->QueueCue(GetOwner(), WeaponData->FireCueTag, Shot.Origin, Shot.Direction, OwnerPawn);
+	}
+}
+
+void ATDSWeapon::PredictShotBatch(const TArray<FTDSShot>& Shots)
+{
+	UTDSTraceBatchSubsystem* TraceBatch = GetWorld() ? GetWorld()->GetSubsystem<UTDSTraceBatchSubsystem>() : nullptr;
+	const APawn* OwnerPawn = Cast<APawn>(GetOwner());
+	if(!TraceBatch || !OwnerPawn || !WeaponData->DamageEffect) return;
+
+	// Give the server a round trip and a half to confirm before the prediction rolls back
+	const APlayerState* PlayerState = OwnerPawn->GetPlayerState();
+	const float RoundTripSeconds = PlayerState ? PlayerState->GetPingInMilliseconds() * 0.001f : 0.0f;
+	const float TimeoutSeconds = RoundTripSeconds * 1.5f + PredictionTimeoutMargin;
+
+	TArray<FTDSTraceRequest> Requests;
+	BuildTraceRequests(Shots, Requests);
+
+	TraceBatch->SubmitPredictionBatch(GetOwner(), Requests, WeaponData->DamageEffect, WeaponData->Damage, TimeoutSeconds);
+}
+
+void ATDSWeapon::BuildTraceRequests(const TArray<FTDSShot>& Shots, TArray<FTDSTraceRequest>& OutRequests) const
+{
+	OutRequests.Reset(Shots.Num() * WeaponData->PelletsPerShot);
+
+	TArray<FVector> PelletDirections;
+	for(const FTDSShot& Shot : Shots)
+	{
+		GetPelletDirections(Shot, PelletDirections);
+		for(const FVector& Direction : PelletDirections)
+		{
+			FTDSTraceRequest& Request = OutRequests.AddDefaulted_GetRef();
+			Request.Start = Shot.Origin;
+			Request.End = Shot.Origin + Direction * WeaponData->Range;
+		}
+	}
+}
+
+FVector ATDSWeapon::GetMuzzleLocation() const
+{
+	return GetActorLocation();
+}
+
+FVector ATDSWeapon::GetAimDirection() const
+{
+	// The owner faces the cursor, the weapon mesh may be animated
+	const AActor* AimActor = GetOwner() ? GetOwner() : this;
+	return AimActor->GetActorForwardVector();
+}
+
+void ATDSWeapon::GetMuzzleAt(float Age, FVector& OutLocation, FVector& OutDirection) const
+{
+	OutLocation = GetMuzzleLocation();
+	OutDirection = GetAimDirection();
+	if(FrameDeltaTime <= 0.0f || Age <= 0.0f) return;
+
+	// Shots banked before this frame started are placed at its start
+	const float Alpha = FMath::Clamp(1.0f - Age / FrameDeltaTime, 0.0f, 1.0f);
+	OutLocation = FMath::Lerp(PreviousMuzzleLocation, OutLocation, Alpha);
+	OutDirection = FQuat::Slerp(PreviousAimDirection.ToOrientationQuat(), OutDirection.ToOrientationQuat(), Alpha).GetForwardVector();
+}
+#pragma endregion Firing
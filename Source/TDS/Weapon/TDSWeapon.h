@@ -4,22 +4,55 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "Engine/NetSerialization.h"
 #include "TDSWeapon.generated.h"
 
+class UTDSWeaponData;
+class ATDSWeapon;
+struct FTDSTraceRequest;
+
+/**
+ * A single shot. Spread and pellet directions are derived from Seed so the server rebuilds the same traces.
+ */
+USTRUCT(BlueprintType)
+struct FTDSShot
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "Firing")
+	FVector_NetQuantize Origin;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Firing")
+	FVector_NetQuantizeNormal Direction;
+
+	/** Seconds between the exact fire time of the shot and the end of the frame that emitted it. Origin and aim are taken at that time. */
+	UPROPERTY(BlueprintReadOnly, Category = "Firing")
+	float Age{0.0f};
+
+	UPROPERTY()
+	int32 Seed{0};
+};
+
+DECLARE_MULTICAST_DELEGATE_TwoParams(FOnTDSWeaponShotBatch, ATDSWeapon*, const TArray<FTDSShot>&);
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnTDSWeaponReload, ATDSWeapon*);
+
 UCLASS()
 class TDS_API ATDSWeapon : public AActor
 {
 	GENERATED_BODY()
-	
-public:	
+
+public:
 	// Sets default values for this actor's properties
 	ATDSWeapon();
 
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+public:
+	virtual void Tick(float DeltaTime) override;
 
-public:	
 	void Equip();
 	void UnEquip();
 
@@ -29,5 +62,104 @@ public:
 	UFUNCTION(BlueprintImplementableEvent, Category = "Equipment")
 	void OnUnEquip();
 
-	
+#pragma region Firing
+	/** True when firing is driven natively by WeaponData instead of a firing ability. */
+	bool HasNativeFiring() const { return WeaponData != nullptr; }
+
+	void StartFire();
+	void StopFire();
+
+	UFUNCTION(BlueprintCallable, Category = "Firing")
+	void Reload();
+
+	UFUNCTION(BlueprintPure, Category = "Firing")
+	int32 GetAmmo() const { return Ammo; }
+
+	UFUNCTION(BlueprintPure, Category = "Firing")
+	bool IsReloading() const { return ReloadRemaining > 0.0f; }
+
+	/** Pellet directions of a shot, rebuilt from its seed. */
+	void GetPelletDirections(const FTDSShot& Shot, TArray<FVector>& OutDirections) const;
+
+	/**
+	 * Server side check of a batch sent by a remote client, against the weapon's own fire clock and magazine.
+	 * Shots the fire rate, ammo or a running reload do not allow are removed, ages are clamped to the simulated
+	 * time since the previous batch and origins are replaced by the server's muzzle location. The reload itself
+	 * comes from the client, an empty magazine rejects shots until it arrives.
+	 */
+	void AcceptRemoteShots(TArray<FTDSShot>& Shots);
+
+	/** Server side resolution of every shot fired by the owner during one frame. */
+	virtual void HandleShotBatch(const TArray<FTDSShot>& Shots);
+
+	/** Client side prediction of the same batch, shown on the targets' vitals until the server confirms. */
+	virtual void PredictShotBatch(const TArray<FTDSShot>& Shots);
+
+	/** Broadcast on the firing machine with every shot fired during a frame, or during a simulation step on the server. */
+	FOnTDSWeaponShotBatch OnShotBatch;
+
+	/** Broadcast when a reload starts, so the server's copy of the weapon reloads as well. */
+	FOnTDSWeaponReload OnReload;
+
+	/** Cosmetic feedback on the firing machine, with every OnShotBatch. */
+	UFUNCTION(BlueprintImplementableEvent, Category = "Firing")
+	void OnFire(const TArray<FTDSShot>& Shots);
+
+	/** Hit resolution on the server for weapons without a native DamageEffect, once per received batch. */
+	UFUNCTION(BlueprintImplementableEvent, Category = "Firing")
+	void OnResolveShots(const TArray<FTDSShot>& Shots);
+#pragma endregion Firing
+
+protected:
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Firing")
+	UTDSWeaponData* WeaponData;
+
+	virtual FVector GetMuzzleLocation() const;
+	virtual FVector GetAimDirection() const;
+
+	/** Muzzle location and aim Age seconds before the end of this frame, interpolated from the previous frame's. */
+	void GetMuzzleAt(float Age, FVector& OutLocation, FVector& OutDirection) const;
+
+	/** Seconds of shots a remote client may deliver at once on top of the fire rate, covers network jitter. */
+	UPROPERTY(EditDefaultsOnly, Category = "Firing", meta = (ClampMin = 0.0f))
+	float RemoteShotTolerance{0.25f};
+
+	/** Added to 1.5 round trips before an unconfirmed predicted hit is rolled back. */
+	UPROPERTY(EditDefaultsOnly, Category = "Firing", meta = (ClampMin = 0.0f))
+	float PredictionTimeoutMargin{0.1f};
+
+	/** Fire clock, reload and remote shot budget, from the scheduler's Critical step on the server and Tick elsewhere. */
+	void StepFiring(float StepTime);
+	void AdvanceFiring(float DeltaTime);
+	void BroadcastPendingShots();
+	bool WantsToFire() const;
+	void BuildTraceRequests(const TArray<FTDSShot>& Shots, TArray<FTDSTraceRequest>& OutRequests) const;
+
+	/** Fire cues, played at once by the shooter and batched to everyone else by the server. */
+	void PlayLocalFireCues(const TArray<FTDSShot>& Shots) const;
+	void QueueFireCues(const TArray<FTDSShot>& Shots) const;
+
+private:
+	bool bTriggerHeld{false};
+	int32 ShotsLeftInBurst{0};
+	int32 Ammo{0};
+	float ReloadRemaining{0.0f};
+
+	/** Time banked towards the next shot, capped at one interval while idle. */
+	float FireClock{0.0f};
+
+	FRandomStream SeedStream;
+	TArray<FTDSShot> PendingShots;
+
+	/** Muzzle at the end of the previous frame or step and the length of this one, shots in between are placed on the way. */
+	FVector PreviousMuzzleLocation{FVector::ZeroVector};
+	FVector PreviousAimDirection{FVector::ForwardVector};
+	float FrameDeltaTime{0.0f};
+
+	/** Shots a remote client may still fire, refilled at the fire rate. Server only. */
+	float RemoteShotBudget{1.0f};
+	float TimeSinceRemoteBatch{0.0f};
+
+	/** Whether StepFiring runs from UTDSSimulationScheduler instead of Tick. */
+	bool bSteppedFiring{false};
 };
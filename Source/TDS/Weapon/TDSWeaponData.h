@@ -0,0 +1,63 @@
+// Copyright, The Lounge
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "GameplayTagContainer.h"
+#include "TDSWeaponData.generated.h"
+
+class UGameplayEffect;
+
+/**
+ * Firing parameters shared by every instance of a weapon type.
+ */
+UCLASS(BlueprintType)
+class TDS_API UTDSWeaponData : public UPrimaryDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	/** Rounds per minute while firing. */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Firing", meta = (ClampMin = 1.0f))
+	float FireRate{600.0f};
+
+	/** Shots fired per trigger pull, 0 for full auto. */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Firing", meta = (ClampMin = 0))
+	int32 BurstCount{0};
+
+	/** Traces per shot, more than one for shotguns. */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Firing", meta = (ClampMin = 1))
+	int32 PelletsPerShot{1};
+
+	/** Half-angle of the spread cone, in degrees. */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Firing", meta = (ClampMin = 0.0f, ClampMax = 90.0f))
+	float SpreadAngle{1.0f};
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Firing", meta = (ClampMin = 0.0f))
+	float Range{5000.0f};
+
+	/** Applied to every target hit, with Damage per pellet as Damage.SetByCaller. Unset to resolve hits in Blueprint. */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Damage")
+	TSubclassOf<UGameplayEffect> DamageEffect;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Damage", meta = (ClampMin = 0.0f))
+	float Damage{10.0f};
+
+	/** Rounds per magazine, 0 for no magazine. */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Ammo", meta = (ClampMin = 0))
+	int32 MagazineSize{30};
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Ammo", meta = (ClampMin = 0.0f))
+	float ReloadTime{1.5f};
+
+	/** Executed at the muzzle per shot, played right away by the shooter and batched to everyone else. */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Cues", meta = (Categories = "GameplayCue"))
+	FGameplayTag FireCueTag;
+
+	/** Executed at every blocking hit once the server resolved the shots. */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Cues", meta = (Categories = "GameplayCue"))
+	FGameplayTag ImpactCueTag;
+
+	float GetShotInterval() const { return 60.0f / FireRate; }
+};